@@ -24,6 +24,12 @@
 
 OLIVE_NAMESPACE_ENTER
 
+AudioOutputDeviceProxy::AudioOutputDeviceProxy() :
+  pos_(0),
+  playback_speed_(1)
+{
+}
+
 AudioOutputDeviceProxy::~AudioOutputDeviceProxy()
 {
   if (file_.isOpen()) {
@@ -49,7 +55,7 @@ void AudioOutputDeviceProxy::SetDevice(const QString &filename, qint64 offset, i
     return;
   }
 
-  file_.seek(offset);
+  pos_ = offset;
 
   playback_speed_ = playback_speed;
 
@@ -107,28 +113,29 @@ qint64 AudioOutputDeviceProxy::writeData(const char *data, qint64 maxSize)
 
 qint64 AudioOutputDeviceProxy::ReverseAwareRead(char *data, qint64 maxlen)
 {
-  qint64 new_pos = -1;
+  qint64 read_pos;
 
   if (playback_speed_ < 0) {
-    // If we're reversing, we'll seek back by maxlen bytes before we read
-    new_pos = file_.pos() - maxlen;
-
-    if (new_pos < 0) {
-      maxlen = file_.pos();
+    // If we're reversing, we read the maxlen bytes before our position
+    read_pos = qMax(static_cast<qint64>(0), pos_ - maxlen);
+    maxlen = pos_ - read_pos;
+  } else {
+    read_pos = pos_;
+  }
 
-      new_pos = 0;
-    }
+  qint64 read_count = 0;
 
-    file_.seek(new_pos);
+  if (maxlen > 0 && file_.seek(read_pos)) {
+    read_count = qMax(static_cast<qint64>(0), file_.read(data, maxlen));
   }
 
-  qint64 read_count = file_.read(data, maxlen);
-
   if (playback_speed_ < 0) {
-    file_.seek(new_pos);
+    pos_ = read_pos;
 
     // Reverse the samples here
     AudioManager::ReverseBuffer(data, static_cast<int>(read_count), params_.samples_to_bytes(1));
+  } else {
+    pos_ += read_count;
   }
 
   return read_count;
@@ -35,7 +35,7 @@ class AudioOutputDeviceProxy : public QIODevice
 {
   Q_OBJECT
 public:
-  AudioOutputDeviceProxy() = default;
+  AudioOutputDeviceProxy();
 
   virtual ~AudioOutputDeviceProxy() override;
 
@@ -53,8 +53,12 @@ protected:
 private:
   qint64 ReverseAwareRead(char* data, qint64 maxlen);
 
+  // The rendered audio is still being written to and can be truncated at any time, so it's read normally rather than
+  // mapped. We track our own position so reverse playback doesn't need to seek back and forth around each read.
   QFile file_;
 
+  qint64 pos_;
+
   TempoProcessor tempo_processor_;
 
   AudioRenderingParams params_;
@@ -0,0 +1,153 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+
+#include "samplekernels.h"
+
+#include <algorithm>
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OLIVE_SAMPLEKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+OLIVE_NAMESPACE_ENTER
+
+#ifdef OLIVE_SAMPLEKERNELS_SSE2
+// NOTE: The loaded samples are passed as the first argument of _mm_min_ps/_mm_max_ps, which return the second
+//       argument if either is NaN. That way a NaN sample is ignored the same way the scalar comparisons ignore it.
+
+static void FoldLanes(__m128 vmin, __m128 vmax, int nb_channels, float* mins, float* maxs)
+{
+  float lane_min[4];
+  float lane_max[4];
+
+  _mm_storeu_ps(lane_min, vmin);
+  _mm_storeu_ps(lane_max, vmax);
+
+  for (int i=0;i<4;i++) {
+    int channel = i % nb_channels;
+
+    mins[channel] = std::min(mins[channel], lane_min[i]);
+    maxs[channel] = std::max(maxs[channel], lane_max[i]);
+  }
+}
+#endif
+
+void SampleKernels::MinMax(const float *data, int count, float *min, float *max)
+{
+  MinMaxInterleaved(data, count, 1, min, max);
+}
+
+void SampleKernels::MinMaxInterleaved(const float *data, int count, int nb_channels, float *mins, float *maxs)
+{
+  int i = 0;
+
+#ifdef OLIVE_SAMPLEKERNELS_SSE2
+  // With 1, 2 or 4 channels every lane of a vector always holds the same channel, so we can reduce whole vectors and
+  // fold the lanes back into their channels at the end
+  if (4 % nb_channels == 0) {
+    float lane_min[4];
+    float lane_max[4];
+
+    for (int j=0;j<4;j++) {
+      lane_min[j] = mins[j % nb_channels];
+      lane_max[j] = maxs[j % nb_channels];
+    }
+
+    __m128 vmin = _mm_loadu_ps(lane_min);
+    __m128 vmax = _mm_loadu_ps(lane_max);
+
+    for (;i+4<=count;i+=4) {
+      __m128 v = _mm_loadu_ps(data + i);
+
+      vmin = _mm_min_ps(v, vmin);
+      vmax = _mm_max_ps(v, vmax);
+    }
+
+    FoldLanes(vmin, vmax, nb_channels, mins, maxs);
+  }
+#endif
+
+  // Anything left over (or everything if we couldn't vectorize), walking each channel with a stride rather than
+  // taking the channel from a modulo of every index
+  for (int channel=0;channel<nb_channels;channel++) {
+    float& min = mins[channel];
+    float& max = maxs[channel];
+
+    for (int j=i+channel;j<count;j+=nb_channels) {
+      const float& v = data[j];
+
+      if (v < min) {
+        min = v;
+      }
+
+      if (v > max) {
+        max = v;
+      }
+    }
+  }
+}
+
+void SampleKernels::Reverse(float *data, int count)
+{
+  int lo = 0;
+  int hi = count - 1;
+
+#ifdef OLIVE_SAMPLEKERNELS_SSE2
+  // Swap whole vectors from each end while they don't overlap
+  for (;lo+8<=hi+1;lo+=4,hi-=4) {
+    __m128 a = _mm_loadu_ps(data + lo);
+    __m128 b = _mm_loadu_ps(data + hi - 3);
+
+    _mm_storeu_ps(data + lo, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)));
+    _mm_storeu_ps(data + hi - 3, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)));
+  }
+#endif
+
+  for (;lo<hi;lo++,hi--) {
+    std::swap(data[lo], data[hi]);
+  }
+}
+
+void SampleKernels::Resample(const float *input, int input_count, float *output, int output_count, double step)
+{
+  if (input_count <= 0) {
+    return;
+  }
+
+  // Step through the input in 32.32 fixed point so we don't need a double multiply and round for every sample. The
+  // position starts at 0.5 so truncating it rounds to the nearest sample.
+  const quint64 fixed_step = static_cast<quint64>(step * 4294967296.0 + 0.5);
+  quint64 fixed_pos = Q_UINT64_C(0x80000000);
+
+  const int last_input = input_count - 1;
+
+  for (int i=0;i<output_count;i++) {
+    int input_index = static_cast<int>(fixed_pos >> 32);
+
+    output[i] = input[qMin(input_index, last_input)];
+
+    fixed_pos += fixed_step;
+  }
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,69 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SAMPLEKERNELS_H
+#define SAMPLEKERNELS_H
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Tight loops over raw float sample data
+ *
+ * These run for every block render and every waveform refresh so they're written to be vectorized. Where the target
+ * supports SSE2 they're implemented with intrinsics, otherwise a plain scalar loop is used. All functions operate on
+ * contiguous float arrays (i.e. a single planar channel) unless otherwise noted.
+ */
+class SampleKernels {
+public:
+  /**
+   * @brief Widens `min` and `max` to include every sample in `data`
+   *
+   * `min` and `max` are used as the starting values so a running range can be built up over several calls.
+   */
+  static void MinMax(const float* data, int count, float* min, float* max);
+
+  /**
+   * @brief Same as MinMax() but over packed data, producing one range per channel
+   *
+   * `count` is the total number of floats in `data` (i.e. samples per channel multiplied by `nb_channels`). `mins`
+   * and `maxs` must each point to `nb_channels` starting values.
+   */
+  static void MinMaxInterleaved(const float* data, int count, int nb_channels, float* mins, float* maxs);
+
+  /**
+   * @brief Reverses the order of `count` samples in place
+   */
+  static void Reverse(float* data, int count);
+
+  /**
+   * @brief Nearest-sample resample of `input` into `output`, reading `step` input samples per output sample
+   *
+   * `input` and `output` may be the same array provided `step` is at least 1.0, since the read position never falls
+   * behind the write position in that case.
+   */
+  static void Resample(const float* input, int input_count, float* output, int output_count, double step);
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // SAMPLEKERNELS_H
@@ -22,13 +22,20 @@
 
 #include <QDebug>
 
+#include "samplekernels.h"
+
 OLIVE_NAMESPACE_ENTER
 
 const int SampleSummer::kSumSampleRate = 200;
 
 QVector<SampleSummer::Sum> SampleSummer::SumSamples(const float *samples, int nb_samples, int nb_channels)
 {
-  return SumSamplesInternal<float>(samples, nb_samples, nb_channels);
+  QVector<float> mins(nb_channels, 0.0f);
+  QVector<float> maxs(nb_channels, 0.0f);
+
+  SampleKernels::MinMaxInterleaved(samples, nb_samples, nb_channels, mins.data(), maxs.data());
+
+  return MinMaxToSums(mins, maxs);
 }
 
 QVector<SampleSummer::Sum> SampleSummer::SumSamples(const qfloat16 *samples, int nb_samples, int nb_channels)
@@ -38,17 +45,17 @@ QVector<SampleSummer::Sum> SampleSummer::SumSamples(const qfloat16 *samples, int
 
 QVector<SampleSummer::Sum> SampleSummer::SumSamples(SampleBufferPtr samples, int start_index, int length)
 {
-  QVector<SampleSummer::Sum> summed_samples(samples->audio_params().channel_count());
+  int nb_channels = samples->audio_params().channel_count();
 
-  int end_index = start_index + length;
+  QVector<float> mins(nb_channels, 0.0f);
+  QVector<float> maxs(nb_channels, 0.0f);
 
-  for (int i=start_index;i<end_index;i++) {
-    for (int channel=0;channel<samples->audio_params().channel_count();channel++) {
-      ClampMinMax<float>(summed_samples[channel], samples->data()[channel][i]);
-    }
+  // Buffer is planar so each channel is one contiguous run
+  for (int channel=0;channel<nb_channels;channel++) {
+    SampleKernels::MinMax(samples->data()[channel] + start_index, length, &mins[channel], &maxs[channel]);
   }
 
-  return summed_samples;
+  return MinMaxToSums(mins, maxs);
 }
 
 QVector<SampleSummer::Sum> SampleSummer::ReSumSamples(const SampleSummer::Sum *samples, int nb_samples, int nb_channels)
@@ -83,8 +90,22 @@ QVector<SampleSummer::Sum> SampleSummer::SumSamplesInternal(const T *samples, in
 {
   QVector<SampleSummer::Sum> summed_samples(nb_channels);
 
-  for (int i=0;i<nb_samples;i++) {
-    ClampMinMax<T>(summed_samples[i%nb_channels], samples[i]);
+  for (int channel=0;channel<nb_channels;channel++) {
+    for (int i=channel;i<nb_samples;i+=nb_channels) {
+      ClampMinMax<T>(summed_samples[channel], samples[i]);
+    }
+  }
+
+  return summed_samples;
+}
+
+QVector<SampleSummer::Sum> SampleSummer::MinMaxToSums(const QVector<float> &mins, const QVector<float> &maxs)
+{
+  QVector<SampleSummer::Sum> summed_samples(mins.size());
+
+  for (int i=0;i<summed_samples.size();i++) {
+    summed_samples[i].min = mins.at(i);
+    summed_samples[i].max = maxs.at(i);
   }
 
   return summed_samples;
@@ -102,9 +123,4 @@ void SampleSummer::ClampMinMax(SampleSummer::Sum &sum, T value)
   }
 }
 
-SampleSummer::Info::Info()
-{
-  channels = 0;
-}
-
 OLIVE_NAMESPACE_EXIT
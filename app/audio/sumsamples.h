@@ -46,12 +46,6 @@ public:
 
   static QVector<Sum> ReSumSamples(const SampleSummer::Sum* samples, int nb_samples, int nb_channels);
 
-  struct Info {
-    Info();
-
-    int channels;
-  };
-
 private:
   template <typename T>
   static QVector<Sum> SumSamplesInternal(const T* samples, int nb_samples, int nb_channels);
@@ -59,6 +53,8 @@ private:
   template <typename T>
   static void ClampMinMax(Sum &sum, T value);
 
+  static QVector<Sum> MinMaxToSums(const QVector<float>& mins, const QVector<float>& maxs);
+
 };
 
 OLIVE_NAMESPACE_EXIT
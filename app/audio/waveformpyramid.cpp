@@ -0,0 +1,359 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+
+#include "waveformpyramid.h"
+
+#include <QDebug>
+#include <QtMath>
+
+#include "codec/waveinput.h"
+#include "samplekernels.h"
+
+OLIVE_NAMESPACE_ENTER
+
+const int WaveformPyramid::kLevelDivider = 4;
+
+static const char kWaveformMagic[4] = {'O', 'W', 'F', 'P'};
+static const qint32 kWaveformVersion = 1;
+
+// Converts packed samples of any format into floats in the -1.0 to 1.0 range
+static void ConvertToFloat(const char* data, SampleFormat::Format format, int count, float* output)
+{
+  switch (format) {
+  case SampleFormat::SAMPLE_FMT_U8:
+  {
+    const quint8* d = reinterpret_cast<const quint8*>(data);
+    for (int i=0;i<count;i++) {
+      output[i] = (static_cast<float>(d[i]) - 128.0f) / 128.0f;
+    }
+    break;
+  }
+  case SampleFormat::SAMPLE_FMT_S16:
+  {
+    const qint16* d = reinterpret_cast<const qint16*>(data);
+    for (int i=0;i<count;i++) {
+      output[i] = static_cast<float>(d[i]) / 32768.0f;
+    }
+    break;
+  }
+  case SampleFormat::SAMPLE_FMT_S32:
+  {
+    const qint32* d = reinterpret_cast<const qint32*>(data);
+    for (int i=0;i<count;i++) {
+      output[i] = static_cast<float>(static_cast<double>(d[i]) / 2147483648.0);
+    }
+    break;
+  }
+  case SampleFormat::SAMPLE_FMT_S64:
+  {
+    const qint64* d = reinterpret_cast<const qint64*>(data);
+    for (int i=0;i<count;i++) {
+      output[i] = static_cast<float>(static_cast<double>(d[i]) / 9223372036854775808.0);
+    }
+    break;
+  }
+  case SampleFormat::SAMPLE_FMT_FLT:
+    memcpy(output, data, static_cast<size_t>(count) * sizeof(float));
+    break;
+  case SampleFormat::SAMPLE_FMT_DBL:
+  {
+    const double* d = reinterpret_cast<const double*>(data);
+    for (int i=0;i<count;i++) {
+      output[i] = static_cast<float>(d[i]);
+    }
+    break;
+  }
+  case SampleFormat::SAMPLE_FMT_INVALID:
+  case SampleFormat::SAMPLE_FMT_COUNT:
+    memset(output, 0, static_cast<size_t>(count) * sizeof(float));
+    break;
+  }
+}
+
+WaveformPyramid::WaveformPyramid() :
+  map_(nullptr)
+{
+  memset(&header_, 0, sizeof(Header));
+}
+
+WaveformPyramid::~WaveformPyramid()
+{
+  close();
+}
+
+bool WaveformPyramid::Build(const QString &wave_fn, const QString &output_fn, const QAtomicInt *cancelled)
+{
+  WaveInput input(wave_fn);
+
+  if (!input.open()) {
+    qWarning() << "Failed to open WAV file for waveform:" << wave_fn;
+    return false;
+  }
+
+  const AudioRenderingParams& params = input.params();
+  const int nb_channels = params.channel_count();
+  const qint64 sample_count = input.sample_count();
+
+  if (!nb_channels || !sample_count) {
+    input.close();
+    return false;
+  }
+
+  // Lay out every level up front so the whole file can be sized and mapped once
+  Header header;
+  memset(&header, 0, sizeof(Header));
+  memcpy(header.magic, kWaveformMagic, sizeof(kWaveformMagic));
+  header.version = kWaveformVersion;
+  header.channels = nb_channels;
+  header.rate = SampleSummer::kSumSampleRate;
+  header.divider = kLevelDivider;
+
+  const qint64 sum_size = nb_channels * static_cast<qint64>(sizeof(SampleSummer::Sum));
+
+  qint64 level_length = (sample_count * header.rate + params.sample_rate() - 1) / params.sample_rate();
+  qint64 file_size = sizeof(Header);
+
+  do {
+    header.level_length[header.level_count] = level_length;
+    header.level_offset[header.level_count] = file_size;
+    header.level_count++;
+
+    file_size += level_length * sum_size;
+    level_length = (level_length + kLevelDivider - 1) / kLevelDivider;
+  } while (header.level_length[header.level_count - 1] > 1 && header.level_count < kMaxLevels);
+
+  QFile output(output_fn);
+
+  if (!output.open(QFile::ReadWrite | QFile::Truncate)
+      || !output.resize(file_size)) {
+    qWarning() << "Failed to open waveform output:" << output_fn;
+    input.close();
+    return false;
+  }
+
+  uchar* out_map = output.map(0, file_size);
+
+  if (!out_map) {
+    qWarning() << "Failed to map waveform output:" << output_fn;
+    output.close();
+    output.remove();
+    input.close();
+    return false;
+  }
+
+  memcpy(out_map, &header, sizeof(Header));
+
+  // First level is summed straight from the audio
+  SampleSummer::Sum* level_data = reinterpret_cast<SampleSummer::Sum*>(out_map + header.level_offset[0]);
+  QVector<float> converted;
+  QVector<float> mins(nb_channels);
+  QVector<float> maxs(nb_channels);
+  bool is_float = (params.format() == SampleFormat::SAMPLE_FMT_FLT);
+
+  for (qint64 i=0;i<header.level_length[0];i++) {
+    if (cancelled && *cancelled) {
+      break;
+    }
+
+    // Sum boundaries are calculated from the index so sample rates that aren't a multiple of the sum rate don't drift
+    qint64 sum_start = i * params.sample_rate() / header.rate;
+    qint64 sum_end = qMin(sample_count, (i + 1) * params.sample_rate() / header.rate);
+    int sum_samples = static_cast<int>(sum_end - sum_start);
+    int sum_values = sum_samples * nb_channels;
+
+    QByteArray raw = input.read_mapped(params.samples_to_bytes(static_cast<int>(sum_start)),
+                                       params.samples_to_bytes(sum_samples));
+
+    const float* samples;
+
+    if (is_float) {
+      samples = reinterpret_cast<const float*>(raw.constData());
+    } else {
+      converted.resize(sum_values);
+      ConvertToFloat(raw.constData(), params.format(), sum_values, converted.data());
+      samples = converted.constData();
+    }
+
+    mins.fill(0.0f);
+    maxs.fill(0.0f);
+
+    SampleKernels::MinMaxInterleaved(samples, sum_values, nb_channels, mins.data(), maxs.data());
+
+    SampleSummer::Sum* sum = level_data + i * nb_channels;
+    for (int j=0;j<nb_channels;j++) {
+      sum[j].min = mins.at(j);
+      sum[j].max = maxs.at(j);
+    }
+  }
+
+  input.close();
+
+  // Every other level is summed from the one below it
+  for (int level=1;level<header.level_count;level++) {
+    if (cancelled && *cancelled) {
+      break;
+    }
+
+    const SampleSummer::Sum* src = reinterpret_cast<const SampleSummer::Sum*>(out_map + header.level_offset[level - 1]);
+    SampleSummer::Sum* dst = reinterpret_cast<SampleSummer::Sum*>(out_map + header.level_offset[level]);
+    qint64 src_length = header.level_length[level - 1];
+
+    for (qint64 i=0;i<header.level_length[level];i++) {
+      qint64 src_index = i * kLevelDivider;
+      int src_count = static_cast<int>(qMin(static_cast<qint64>(kLevelDivider), src_length - src_index));
+
+      QVector<SampleSummer::Sum> summary = SampleSummer::ReSumSamples(src + src_index * nb_channels,
+                                                                      src_count * nb_channels,
+                                                                      nb_channels);
+
+      memcpy(dst + i * nb_channels, summary.constData(), static_cast<size_t>(sum_size));
+    }
+  }
+
+  output.unmap(out_map);
+  output.close();
+
+  if (cancelled && *cancelled) {
+    output.remove();
+    return false;
+  }
+
+  return true;
+}
+
+bool WaveformPyramid::open(const QString &fn)
+{
+  close();
+
+  file_.setFileName(fn);
+
+  if (!file_.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  map_ = file_.map(0, file_.size());
+
+  if (!map_ || !ReadHeader(map_, file_.size(), &header_)) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+bool WaveformPyramid::is_open() const
+{
+  return map_;
+}
+
+void WaveformPyramid::close()
+{
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+
+  file_.close();
+}
+
+int WaveformPyramid::channel_count() const
+{
+  return header_.channels;
+}
+
+int WaveformPyramid::level_count() const
+{
+  return header_.level_count;
+}
+
+double WaveformPyramid::level_rate(int level) const
+{
+  return static_cast<double>(header_.rate) / qPow(header_.divider, level);
+}
+
+int WaveformPyramid::GetLevelForRate(double rate) const
+{
+  int level = 0;
+
+  while (level + 1 < level_count() && level_rate(level + 1) >= rate) {
+    level++;
+  }
+
+  return level;
+}
+
+QVector<SampleSummer::Sum> WaveformPyramid::Summarize(int level, double start, double end) const
+{
+  if (!is_open() || level < 0 || level >= level_count()) {
+    return QVector<SampleSummer::Sum>();
+  }
+
+  double rate = level_rate(level);
+  qint64 length = header_.level_length[level];
+
+  qint64 start_index = qMax(static_cast<qint64>(0), static_cast<qint64>(qFloor(start * rate)));
+  qint64 end_index = qMin(length, static_cast<qint64>(qCeil(end * rate)));
+
+  if (start_index >= length || end_index <= 0) {
+    return QVector<SampleSummer::Sum>();
+  }
+
+  // Always cover at least one sum
+  end_index = qMax(end_index, start_index + 1);
+
+  const SampleSummer::Sum* sums = reinterpret_cast<const SampleSummer::Sum*>(map_ + header_.level_offset[level]);
+
+  return SampleSummer::ReSumSamples(sums + start_index * header_.channels,
+                                    static_cast<int>(end_index - start_index) * header_.channels,
+                                    header_.channels);
+}
+
+bool WaveformPyramid::ReadHeader(const uchar *data, qint64 size, Header *header)
+{
+  if (size < static_cast<qint64>(sizeof(Header))) {
+    return false;
+  }
+
+  memcpy(header, data, sizeof(Header));
+
+  if (memcmp(header->magic, kWaveformMagic, sizeof(kWaveformMagic))
+      || header->version != kWaveformVersion
+      || header->channels <= 0
+      || header->rate <= 0
+      || header->divider <= 1
+      || header->level_count <= 0
+      || header->level_count > kMaxLevels) {
+    return false;
+  }
+
+  // Make sure no level reaches past the end of the file
+  qint64 sum_size = header->channels * static_cast<qint64>(sizeof(SampleSummer::Sum));
+
+  for (int i=0;i<header->level_count;i++) {
+    if (header->level_offset[i] + header->level_length[i] * sum_size > size) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+OLIVE_NAMESPACE_EXIT
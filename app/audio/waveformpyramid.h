@@ -0,0 +1,112 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+
+#ifndef WAVEFORMPYRAMID_H
+#define WAVEFORMPYRAMID_H
+
+#include <QAtomicInt>
+#include <QFile>
+
+#include "sumsamples.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Multi-resolution peak summary of an audio stream
+ *
+ * The first level holds one SampleSummer::Sum per channel at SampleSummer::kSumSampleRate, and every level after that
+ * summarizes kLevelDivider sums of the level before it (i.e. 200Hz, 50Hz, 12.5Hz...). All levels are stored in one
+ * file that's memory mapped for reading, so drawing a waveform at any zoom only touches roughly one sum per pixel.
+ */
+class WaveformPyramid
+{
+public:
+  WaveformPyramid();
+
+  ~WaveformPyramid();
+
+  DISABLE_COPY_MOVE(WaveformPyramid)
+
+  static const int kLevelDivider;
+
+  /**
+   * @brief Generate a pyramid file from a PCM WAV file
+   *
+   * Levels are built one after another, each one from the level below it, so the source audio is only read once.
+   *
+   * @return True if the file was fully written. If cancelled or if an error occurred, nothing is left at `output_fn`.
+   */
+  static bool Build(const QString& wave_fn, const QString& output_fn, const QAtomicInt* cancelled = nullptr);
+
+  bool open(const QString& fn);
+
+  bool is_open() const;
+
+  void close();
+
+  int channel_count() const;
+
+  int level_count() const;
+
+  /**
+   * @brief Number of sums per second at this level
+   */
+  double level_rate(int level) const;
+
+  /**
+   * @brief Returns the coarsest level that still has at least `rate` sums per second
+   */
+  int GetLevelForRate(double rate) const;
+
+  /**
+   * @brief Summarizes each channel between `start` and `end` (in seconds) at a certain level
+   *
+   * Returns an empty vector if the range is outside of the audio.
+   */
+  QVector<SampleSummer::Sum> Summarize(int level, double start, double end) const;
+
+private:
+  static const int kMaxLevels = 16;
+
+  struct Header {
+    char magic[4];
+    qint32 version;
+    qint32 channels;
+    qint32 rate;
+    qint32 divider;
+    qint32 level_count;
+    qint64 level_length[kMaxLevels];
+    qint64 level_offset[kMaxLevels];
+  };
+
+  static bool ReadHeader(const uchar* data, qint64 size, Header* header);
+
+  QFile file_;
+
+  uchar* map_;
+
+  Header header_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // WAVEFORMPYRAMID_H
@@ -22,19 +22,27 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
 #include <QFileInfo>
 
+#include "audio/waveformpyramid.h"
+#include "codec/encoder.h"
 #include "codec/ffmpeg/ffmpegcommon.h"
 #include "codec/ffmpeg/ffmpegdecoder.h"
 #include "codec/oiio/oiiodecoder.h"
 #include "codec/waveinput.h"
 #include "codec/waveoutput.h"
+#include "common/timecodefunctions.h"
 #include "render/backend/indexmanager.h"
+#include "render/diskmanager.h"
 #include "task/index/index.h"
 #include "task/taskmanager.h"
 
 OLIVE_NAMESPACE_ENTER
 
+const int Decoder::kProxyDivider = 2;
+const int Decoder::kProxyWidthThreshold = 1920;
+
 Decoder::Decoder() :
   open_(false),
   stream_(nullptr)
@@ -64,6 +72,11 @@ FramePtr Decoder::RetrieveVideo(const rational &/*timecode*/, const int &/*divid
   return nullptr;
 }
 
+YUVFramePtr Decoder::RetrieveVideoYUV(const rational &/*timecode*/, const int &/*divider*/)
+{
+  return nullptr;
+}
+
 SampleBufferPtr Decoder::RetrieveAudio(const rational &/*timecode*/, const rational &/*length*/, const AudioRenderingParams &/*params*/)
 {
   return nullptr;
@@ -136,12 +149,25 @@ bool Decoder::ProbeMedia(Footage *f, const QAtomicInt* cancelled)
 
       // Start an index task
       foreach (StreamPtr stream, f->streams()) {
-        if (stream->type() == Stream::kAudio) {
+        if (stream->type() == Stream::kAudio
+            || (stream->type() == Stream::kVideo && !std::static_pointer_cast<VideoStream>(stream)->is_image_sequence())) {
           QMetaObject::invokeMethod(IndexManager::instance(),
                                     "StartIndexingStream",
                                     Qt::QueuedConnection,
                                     OLIVE_NS_ARG(StreamPtr, stream));
         }
+
+        // Start a proxy task for video too large to play back smoothly
+        if (stream->type() == Stream::kVideo) {
+          VideoStreamPtr video_stream = std::static_pointer_cast<VideoStream>(stream);
+
+          if (!video_stream->is_image_sequence() && video_stream->width() > kProxyWidthThreshold) {
+            QMetaObject::invokeMethod(IndexManager::instance(),
+                                      "StartProxyingStream",
+                                      Qt::QueuedConnection,
+                                      OLIVE_NS_ARG(StreamPtr, stream));
+          }
+        }
       }
 
       return true;
@@ -292,6 +318,147 @@ void Decoder::ConformInternal(SwrContext* resampler, WaveOutput* output, const c
   output->write(out_samples);
 }
 
+bool Decoder::Proxy(int divider, const QAtomicInt *cancelled)
+{
+  if (stream()->type() != Stream::kVideo) {
+    // Only video streams can have proxies
+    return false;
+  }
+
+  QString proxy_fn = GetProxyFilename(divider);
+
+  if (proxy_fn.isEmpty()) {
+    // This decoder doesn't store anything on disk so it can't store proxies either
+    return false;
+  }
+
+  if (!QFileInfo::exists(proxy_fn)) {
+    // Transcode to a working filename so an incomplete proxy is never picked up. The extension is kept so the encoder
+    // can still determine the container from it.
+    QFileInfo proxy_info(proxy_fn);
+    QString working_fn = proxy_info.dir().filePath(QStringLiteral("%1.working.%2").arg(proxy_info.completeBaseName(),
+                                                                                         proxy_info.suffix()));
+
+    bool transcoded = TranscodeProxy(working_fn, divider, cancelled);
+
+    if (!transcoded || (cancelled && *cancelled) || !QFile::rename(working_fn, proxy_fn)) {
+      QFile(working_fn).remove();
+      return false;
+    }
+  }
+
+  // Probe the proxy directly rather than through ProbeMedia() so it doesn't get indexed or proxied itself
+  std::shared_ptr<Footage> proxy_footage = std::make_shared<Footage>();
+  proxy_footage->set_filename(proxy_fn);
+
+  FFmpegDecoder proxy_decoder;
+
+  if (proxy_decoder.Probe(proxy_footage.get(), cancelled)) {
+    proxy_footage->set_status(Footage::kReady);
+    proxy_footage->set_decoder(proxy_decoder.id());
+
+    std::static_pointer_cast<VideoStream>(stream())->set_proxy(proxy_footage, divider);
+
+    // Count the proxy against the disk cache limit. It isn't a rendered frame so it has no frame hash, its filename is
+    // used as its key instead.
+    DiskManager::instance()->CreatedFile(proxy_fn, proxy_fn.toUtf8());
+
+    return true;
+  } else {
+    qWarning() << "Failed to probe proxy, removing it:" << proxy_fn;
+    QFile(proxy_fn).remove();
+    return false;
+  }
+}
+
+bool Decoder::TranscodeProxy(const QString &filename, int divider, const QAtomicInt *cancelled)
+{
+  VideoStreamPtr video_stream = std::static_pointer_cast<VideoStream>(stream());
+
+  if (video_stream->frame_rate().isNull() || video_stream->duration() <= 0) {
+    qWarning() << "Can't generate proxy for stream with unknown frame rate or duration:" << stream()->footage()->filename();
+    return false;
+  }
+
+  if (!Open()) {
+    qWarning() << "Failed to open decoder for proxy:" << stream()->footage()->filename();
+    return false;
+  }
+
+  // Proxies are written frame-by-frame at the stream's frame rate
+  rational frame_timebase = video_stream->frame_rate().flipped();
+
+  int64_t frame_count = Timecode::time_to_timestamp(Timecode::timestamp_to_time(video_stream->duration(),
+                                                                                video_stream->timebase()),
+                                                    frame_timebase);
+
+  Encoder* encoder = nullptr;
+  bool success = true;
+
+  for (int64_t i=0;i<frame_count;i++) {
+    if (cancelled && *cancelled) {
+      success = false;
+      break;
+    }
+
+    rational time = Timecode::timestamp_to_time(i, frame_timebase);
+
+    FramePtr frame = RetrieveVideo(time, divider);
+
+    if (!frame) {
+      // Skip it, the previous frame in the proxy will be shown in its place
+      continue;
+    }
+
+    if (!encoder) {
+      // We create the encoder from the first frame since that tells us the exact dimensions and format
+      EncodingParams params;
+      params.SetFilename(filename);
+      params.EnableVideo(VideoRenderingParams(frame->width(),
+                                              frame->height(),
+                                              frame_timebase,
+                                              frame->format(),
+                                              RenderMode::kOffline),
+                         QStringLiteral("prores_ks"));
+
+      // ProRes is intra-frame and cheap to decode, which is what we want for scrubbing. The "proxy" profile is the
+      // lightest of its variants.
+      params.SetVideoOption(QStringLiteral("profile"), QStringLiteral("proxy"));
+
+      encoder = Encoder::CreateFromID(QStringLiteral("ffmpeg"), params);
+
+      bool opened = false;
+      connect(encoder, &Encoder::OpenSucceeded, this, [&opened](){
+        opened = true;
+      }, Qt::DirectConnection);
+
+      encoder->Open();
+
+      if (!opened) {
+        qWarning() << "Failed to open encoder for proxy:" << filename;
+        success = false;
+        break;
+      }
+    }
+
+    encoder->WriteFrame(frame, time);
+
+    emit IndexProgress(qRound(100.0 * static_cast<double>(i) / static_cast<double>(frame_count)));
+  }
+
+  if (encoder) {
+    encoder->Close();
+    delete encoder;
+  } else {
+    // No frames were ever retrieved
+    success = false;
+  }
+
+  Close();
+
+  return success;
+}
+
 QString Decoder::GetConformedFilename(const AudioRenderingParams &params)
 {
   QString index_fn = GetIndexFilename();
@@ -319,6 +486,61 @@ QString Decoder::GetConformedFilename(const AudioRenderingParams &params)
   return index_fn;
 }
 
+QString Decoder::GetProxyFilename(int divider)
+{
+  QString index_fn = GetIndexFilename();
+
+  if (index_fn.isEmpty()) {
+    return index_fn;
+  }
+
+  index_fn.append(QStringLiteral(".proxy"));
+  index_fn.append(QString::number(divider));
+  index_fn.append(QStringLiteral(".mov"));
+
+  return index_fn;
+}
+
+QString Decoder::GetWaveformFilename()
+{
+  QString index_fn = GetIndexFilename();
+
+  if (index_fn.isEmpty()) {
+    return index_fn;
+  }
+
+  index_fn.append(QStringLiteral(".waveform"));
+
+  return index_fn;
+}
+
+void Decoder::GenerateWaveform(const QAtomicInt *cancelled)
+{
+  if (stream()->type() != Stream::kAudio) {
+    return;
+  }
+
+  QString waveform_fn = GetWaveformFilename();
+
+  if (waveform_fn.isEmpty()) {
+    return;
+  }
+
+  if (!QFileInfo::exists(waveform_fn)) {
+    // Build to a working filename so an incomplete waveform is never picked up
+    QString working_fn = waveform_fn;
+    working_fn.append(QStringLiteral(".working"));
+
+    if (!WaveformPyramid::Build(GetIndexFilename(), working_fn, cancelled)
+        || !QFile::rename(working_fn, waveform_fn)) {
+      QFile(working_fn).remove();
+      return;
+    }
+  }
+
+  std::static_pointer_cast<AudioStream>(stream())->set_waveform_filename(waveform_fn);
+}
+
 void Decoder::Index(const QAtomicInt *)
 {
 }
@@ -32,6 +32,7 @@ extern "C" {
 #include "codec/frame.h"
 #include "codec/samplebuffer.h"
 #include "codec/waveoutput.h"
+#include "codec/yuvframe.h"
 #include "common/rational.h"
 #include "project/item/footage/footage.h"
 
@@ -72,6 +73,18 @@ public:
 
   DISABLE_COPY_MOVE(Decoder)
 
+  /**
+   * @brief Divider proxies are generated at
+   *
+   * Proxies are used for any divider that's a multiple of this, which covers all of the viewer's playback resolutions.
+   */
+  static const int kProxyDivider;
+
+  /**
+   * @brief Video streams wider than this will have a proxy generated for them
+   */
+  static const int kProxyWidthThreshold;
+
   virtual QString id() = 0;
 
   StreamPtr stream();
@@ -145,6 +158,14 @@ public:
    */
   virtual FramePtr RetrieveVideo(const rational& timecode, const int& divider);
 
+  /**
+   * @brief Retrieve video frame in its native planar Y'CbCr format
+   *
+   * Used instead of RetrieveVideo() when Y'CbCr can be converted to RGB on the GPU. Decoders that can't provide
+   * planar Y'CbCr (or footage that isn't Y'CbCr) return nullptr, in which case RetrieveVideo() should be used.
+   */
+  virtual YUVFramePtr RetrieveVideoYUV(const rational& timecode, const int& divider);
+
   /**
    * @brief Retrieve video frame
    *
@@ -239,6 +260,22 @@ public:
    */
   virtual void Index(const QAtomicInt* cancelled);
 
+  /**
+   * @brief Generate a low resolution proxy of this stream (video only)
+   *
+   * Transcodes the stream at the specified divider into an intra-frame intermediate and registers it with the
+   * VideoStream so decoders can use it instead of the source. If a proxy already exists on disk, it's registered
+   * without transcoding.
+   *
+   * The proxy is registered with DiskManager so that it counts towards (and can be evicted by) the disk cache limit.
+   *
+   * Transcoding is slow so it's recommended to do it in a background thread. This function opens and closes the
+   * Decoder itself.
+   *
+   * @return True if a proxy was registered, false if it couldn't be generated or generation was cancelled
+   */
+  bool Proxy(int divider, const QAtomicInt* cancelled);
+
   /**
    * @brief AUDIO ONLY: Returns whether a cached transcode of this audio matching the specified params already exists
    */
@@ -265,6 +302,23 @@ protected:
    */
   QString GetConformedFilename(const AudioRenderingParams &params);
 
+  /**
+   * @brief Get the destination filename of a video stream's proxy at a certain divider
+   */
+  QString GetProxyFilename(int divider);
+
+  /**
+   * @brief Get the filename of an audio stream's waveform pyramid
+   */
+  QString GetWaveformFilename();
+
+  /**
+   * @brief Build a waveform pyramid from the audio index if one doesn't exist yet and register it with the AudioStream
+   *
+   * Must be called after the index is complete since the waveform is summed from it.
+   */
+  void GenerateWaveform(const QAtomicInt* cancelled);
+
   bool open_;
 
   QMutex mutex_;
@@ -272,6 +326,8 @@ protected:
 private:
   void ConformInternal(SwrContext *resampler, WaveOutput *output, const char *in_data, int in_sample_count);
 
+  bool TranscodeProxy(const QString& filename, int divider, const QAtomicInt* cancelled);
+
   StreamPtr stream_;
 
 };
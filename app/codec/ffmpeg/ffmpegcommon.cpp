@@ -20,6 +20,10 @@
 
 #include "ffmpegcommon.h"
 
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
 OLIVE_NAMESPACE_ENTER
 
 AVPixelFormat FFmpegCommon::GetCompatiblePixelFormat(const AVPixelFormat &pix_fmt)
@@ -38,6 +42,30 @@ AVPixelFormat FFmpegCommon::GetCompatiblePixelFormat(const AVPixelFormat &pix_fm
                                            nullptr);
 }
 
+AVPixelFormat FFmpegCommon::GetCompatiblePlanarYUVFormat(const AVPixelFormat &pix_fmt)
+{
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pix_fmt);
+
+  if (!desc
+      || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_ALPHA | AV_PIX_FMT_FLAG_BITSTREAM))
+      || desc->nb_components != 3
+      || av_pix_fmt_count_planes(pix_fmt) != 3
+      || desc->log2_chroma_w > 1
+      || desc->log2_chroma_h > desc->log2_chroma_w) {
+    return AV_PIX_FMT_NONE;
+  }
+
+  bool high_bit_depth = (desc->comp[0].depth > 8);
+
+  if (desc->log2_chroma_h == 1) {
+    return high_bit_depth ? AV_PIX_FMT_YUV420P16 : AV_PIX_FMT_YUV420P;
+  } else if (desc->log2_chroma_w == 1) {
+    return high_bit_depth ? AV_PIX_FMT_YUV422P16 : AV_PIX_FMT_YUV422P;
+  } else {
+    return high_bit_depth ? AV_PIX_FMT_YUV444P16 : AV_PIX_FMT_YUV444P;
+  }
+}
+
 SampleFormat::Format FFmpegCommon::GetNativeSampleFormat(const AVSampleFormat &smp_fmt)
 {
   switch (smp_fmt) {
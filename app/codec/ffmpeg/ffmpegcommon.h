@@ -42,6 +42,15 @@ public:
    */
   static PixelFormat::Format GetCompatiblePixelFormat(const PixelFormat::Format& pix_fmt);
 
+  /**
+   * @brief Returns a planar Y'CbCr format that a frame in this format can be converted to losslessly
+   *
+   * The returned format is always 8-bit or native-endian 16-bit with three planes, suitable for uploading directly to
+   * the GPU. Returns AV_PIX_FMT_NONE if the format is RGB, paletted, has alpha or uses chroma subsampling other than
+   * 4:2:0, 4:2:2 or 4:4:4.
+   */
+  static AVPixelFormat GetCompatiblePlanarYUVFormat(const AVPixelFormat& pix_fmt);
+
   /**
    * @brief Returns an FFmpeg pixel format for a given native pixel format
    */
@@ -31,6 +31,7 @@ extern "C" {
 #include <QFile>
 #include <QFileInfo>
 #include <QString>
+#include <QtConcurrent/QtConcurrent>
 #include <QtMath>
 #include <QThread>
 
@@ -45,16 +46,28 @@ extern "C" {
 
 OLIVE_NAMESPACE_ENTER
 
-QHash< Stream*, QList<FFmpegDecoderInstance*> > FFmpegDecoder::instance_map_;
+QHash< Stream*, FFmpegDecoder::InstancePool > FFmpegDecoder::instance_pools_;
 QMutex FFmpegDecoder::instance_map_lock_;
-QHash< Stream*, FFmpegFramePool* > FFmpegDecoder::frame_pool_map_;
 
 // FIXME: Hardcoded, ideally this value is dynamically chosen based on memory restraints
 const int FFmpegDecoderInstance::kMaxFrameLife = 2000;
+QList<FFmpegDecoderInstance*> FFmpegDecoderInstance::all_instances_;
+QMutex FFmpegDecoderInstance::all_instances_lock_;
+
+// Frames from RetrieveVideo() are usually only held until they're uploaded, so we rarely need more than this
+const int FFmpegDecoder::kMaxOutputFrames = 2;
+
+// Slices smaller than this cost more to dispatch than they save
+const int FFmpegDecoder::kMinimumSliceHeight = 64;
+
+// Destination rows scaled above and below each slice so filtering across slice edges matches a whole-image scale
+const int FFmpegDecoder::kSliceOverlap = 4;
+
+// Frame pools grow and shrink by this many frames at a time, so memory is only reserved as it's needed
+const int FFmpegDecoder::kFramePoolArenaSize = 16;
 
 FFmpegDecoder::FFmpegDecoder() :
-  scale_ctx_(nullptr),
-  scale_divider_(0)
+  yuv_pix_fmt_(AV_PIX_FMT_NONE)
 {
 }
 
@@ -73,6 +86,23 @@ bool FFmpegDecoder::Open()
 
   Q_ASSERT(stream());
 
+  {
+    QMutexLocker l(&instance_map_lock_);
+
+    InstancePool& pool = instance_pools_[stream().get()];
+
+    if (!pool.instances.isEmpty()) {
+      // This stream is already open, we'll share its instances and only open more if they're needed
+      ReadStreamInfo(pool.instances.first());
+
+      pool.decoder_count++;
+
+      open_ = true;
+
+      return true;
+    }
+  }
+
   // Convert QString to a C string
   QByteArray fn_bytes = stream()->footage()->filename().toUtf8();
 
@@ -83,64 +113,40 @@ bool FFmpegDecoder::Open()
     return false;
   }
 
-  if (stream()->type() == Stream::kVideo) {
-    // Get an Olive compatible AVPixelFormat
-    src_pix_fmt_ = static_cast<AVPixelFormat>(our_instance->stream()->codecpar->format);
-    ideal_pix_fmt_ = FFmpegCommon::GetCompatiblePixelFormat(src_pix_fmt_);
-
-    {
-      QMutexLocker map_locker(&instance_map_lock_);
+  ReadStreamInfo(our_instance);
 
-      // FIXME: Test code, this should be changed later
-      FFmpegFramePool* frame_pool = frame_pool_map_.value(stream().get());
+  // All allocation succeeded so we set the state to open
+  open_ = true;
 
-      if (!frame_pool) {
-        frame_pool = new FFmpegFramePool(256,
-                                         our_instance->stream()->codecpar->width,
-                                         our_instance->stream()->codecpar->height,
-                                         static_cast<AVPixelFormat>(our_instance->stream()->codecpar->format));
-        frame_pool_map_.insert(stream().get(), frame_pool);
-      }
+  {
+    QMutexLocker l(&instance_map_lock_);
 
-      our_instance->SetFramePool(frame_pool);
-      // End test code
-    }
+    InstancePool& pool = instance_pools_[stream().get()];
 
-    // Determine which Olive native pixel format we retrieved
-    // Note that FFmpeg doesn't support float formats
-    switch (ideal_pix_fmt_) {
-    case AV_PIX_FMT_RGB24:
-      native_pix_fmt_ = PixelFormat::PIX_FMT_RGB8;
-      break;
-    case AV_PIX_FMT_RGBA:
-      native_pix_fmt_ = PixelFormat::PIX_FMT_RGBA8;
-      break;
-    case AV_PIX_FMT_RGB48:
-      native_pix_fmt_ = PixelFormat::PIX_FMT_RGB16U;
-      break;
-    case AV_PIX_FMT_RGBA64:
-      native_pix_fmt_ = PixelFormat::PIX_FMT_RGBA16U;
-      break;
-    default:
-      // We should never get here, but just in case...
-      qFatal("Invalid output format");
-    }
+    if (stream()->type() == Stream::kVideo) {
+      if (!pool.frame_pool) {
+        pool.frame_pool = new FFmpegFramePool(kFramePoolArenaSize,
+                                              our_instance->stream()->codecpar->width,
+                                              our_instance->stream()->codecpar->height,
+                                              static_cast<AVPixelFormat>(our_instance->stream()->codecpar->format));
+      }
 
-    aspect_ratio_ = our_instance->sample_aspect_ratio();
-  }
+      our_instance->SetFramePool(pool.frame_pool);
 
-  time_base_ = our_instance->stream()->time_base;
-  start_time_ = our_instance->stream()->start_time;
+      // Use the packet index if this stream has been indexed before
+      if (!pool.packet_index) {
+        std::shared_ptr<FFmpegPacketIndex> packet_index = std::make_shared<FFmpegPacketIndex>();
 
-  // All allocation succeeded so we set the state to open
-  open_ = true;
+        if (packet_index->Load(GetIndexFilename())) {
+          pool.packet_index = packet_index;
+        }
+      }
 
-  {
-    QMutexLocker l(&instance_map_lock_);
+      our_instance->SetPacketIndex(pool.packet_index);
+    }
 
-    QList<FFmpegDecoderInstance*> list = instance_map_.value(stream().get());
-    list.append(our_instance);
-    instance_map_.insert(stream().get(), list);
+    pool.instances.append(our_instance);
+    pool.decoder_count++;
   }
 
   return true;
@@ -182,99 +188,333 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divid
     return nullptr;
   }
 
+  if (Decoder* proxy = GetProxyDecoder(divider)) {
+    return proxy->RetrieveVideo(timecode, divider / std::static_pointer_cast<VideoStream>(stream())->proxy_divider());
+  }
+
+  int64_t target_ts = Timecode::time_to_timestamp(timecode, time_base_) + start_time_;
+
+  FFmpegFramePool::ElementPtr return_frame = RetrieveFrameFromInstances(target_ts);
+
+  // We found the frame, we'll return a copy
+  if (return_frame) {
+    const QVector<ScalerSlice>& scaler = GetScaler(divider);
+
+    if (scaler.isEmpty()) {
+      qWarning() << "Failed to create scaler for" << stream()->footage()->filename();
+      return nullptr;
+    }
+
+    VideoStream* vs = static_cast<VideoStream*>(stream().get());
+
+    // Create frame to return
+    FramePtr copy = GetOutputFrame();
+    copy->set_video_params(VideoRenderingParams(GetScaledDimension(vs->width(), divider),
+                                                GetScaledDimension(vs->height(), divider),
+                                                native_pix_fmt_));
+    copy->set_timestamp(Timecode::timestamp_to_time(target_ts, time_base_));
+    copy->set_sample_aspect_ratio(aspect_ratio_);
+    copy->allocate();
+
+    // Align buffer to data/linesize points that can be passed to sws_scale
+    uint8_t* input_data[4];
+    int input_linesize[4];
+
+    av_image_fill_arrays(input_data,
+                         input_linesize,
+                         reinterpret_cast<const uint8_t*>(return_frame->data()),
+                         src_pix_fmt_,
+                         vs->width(),
+                         vs->height(),
+                         1);
+
+    // Convert frame to RGB/A for the rest of the pipeline
+    uint8_t* output_data = reinterpret_cast<uint8_t*>(copy->data());
+    int output_linesize = copy->linesize_bytes();
+
+    // Convert each slice on its own thread, using this thread for the first one
+    QVector< QFuture<void> > slice_futures(scaler.size() - 1);
+
+    for (int i=1;i<scaler.size();i++) {
+      slice_futures[i - 1] = QtConcurrent::run(this,
+                                               &FFmpegDecoder::ScaleSlice,
+                                               scaler.at(i),
+                                               &input_data[0],
+                                               &input_linesize[0],
+                                               output_data,
+                                               output_linesize);
+    }
+
+    ScaleSlice(scaler.first(), input_data, input_linesize, output_data, output_linesize);
+
+    foreach (QFuture<void> f, slice_futures) {
+      f.waitForFinished();
+    }
+
+    return copy;
+  }
+
+  return nullptr;
+}
+
+YUVFramePtr FFmpegDecoder::RetrieveVideoYUV(const rational &timecode, const int &divider)
+{
+  QMutexLocker locker(&mutex_);
+
+  if (!open_) {
+    qWarning() << "Tried to retrieve video on a decoder that's still closed";
+    return nullptr;
+  }
+
+  if (stream()->type() != Stream::kVideo) {
+    return nullptr;
+  }
+
+  if (Decoder* proxy = GetProxyDecoder(divider)) {
+    return proxy->RetrieveVideoYUV(timecode, divider / std::static_pointer_cast<VideoStream>(stream())->proxy_divider());
+  }
+
+  if (yuv_pix_fmt_ == AV_PIX_FMT_NONE) {
+    return nullptr;
+  }
+
   int64_t target_ts = Timecode::time_to_timestamp(timecode, time_base_) + start_time_;
 
+  FFmpegFramePool::ElementPtr return_frame = RetrieveFrameFromInstances(target_ts);
+
+  if (!return_frame) {
+    return nullptr;
+  }
+
+  VideoStream* vs = static_cast<VideoStream*>(stream().get());
+
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(yuv_pix_fmt_);
+
+  YUVFramePtr copy = YUVFrame::Create();
+  copy->set_format(GetScaledDimension(vs->width(), divider),
+                   GetScaledDimension(vs->height(), divider),
+                   desc->log2_chroma_w,
+                   desc->log2_chroma_h,
+                   (desc->comp[0].depth > 8) ? 2 : 1);
+  copy->set_color_matrix(yuv_color_matrix_);
+  copy->set_full_range(yuv_full_range_);
+  copy->set_timestamp(Timecode::timestamp_to_time(target_ts, time_base_));
+  copy->set_sample_aspect_ratio(aspect_ratio_);
+  copy->allocate();
+
+  uint8_t* input_data[4];
+  int input_linesize[4];
+
+  av_image_fill_arrays(input_data,
+                       input_linesize,
+                       reinterpret_cast<const uint8_t*>(return_frame->data()),
+                       src_pix_fmt_,
+                       vs->width(),
+                       vs->height(),
+                       1);
+
+  uint8_t* output_data[4] = {nullptr};
+  int output_linesize[4] = {0};
+
+  for (int i=0;i<YUVFrame::kPlaneCount;i++) {
+    output_data[i] = reinterpret_cast<uint8_t*>(copy->plane_data(i));
+    output_linesize[i] = copy->plane_linesize_bytes(i);
+  }
+
+  if (divider == 1 && src_pix_fmt_ == yuv_pix_fmt_) {
+
+    // Already in the format we want, just copy the planes
+    for (int i=0;i<YUVFrame::kPlaneCount;i++) {
+      av_image_copy_plane(output_data[i],
+                          output_linesize[i],
+                          input_data[i],
+                          input_linesize[i],
+                          copy->plane_width(i) * copy->bytes_per_sample(),
+                          copy->plane_height(i));
+    }
+
+  } else {
+
+    SwsContext* scaler = yuv_scalers_.value(divider);
+
+    if (!scaler) {
+      scaler = sws_getContext(vs->width(),
+                              vs->height(),
+                              src_pix_fmt_,
+                              copy->width(),
+                              copy->height(),
+                              yuv_pix_fmt_,
+                              SWS_FAST_BILINEAR,
+                              nullptr,
+                              nullptr,
+                              nullptr);
+
+      if (!scaler) {
+        qWarning() << "Failed to create Y'CbCr scaler for" << stream()->footage()->filename();
+        return nullptr;
+      }
+
+      // Keep the source's range as-is, the shader handles both
+      int* inv_table;
+      int* table;
+      int src_range, dst_range, brightness, contrast, saturation;
+
+      sws_getColorspaceDetails(scaler, &inv_table, &src_range, &table, &dst_range, &brightness, &contrast, &saturation);
+      sws_setColorspaceDetails(scaler, inv_table, yuv_full_range_, table, yuv_full_range_, brightness, contrast, saturation);
+
+      yuv_scalers_.insert(divider, scaler);
+    }
+
+    sws_scale(scaler,
+              input_data,
+              input_linesize,
+              0,
+              vs->height(),
+              output_data,
+              output_linesize);
+
+  }
+
+  return copy;
+}
+
+FFmpegFramePool::ElementPtr FFmpegDecoder::RetrieveFrameFromInstances(const int64_t &target_ts)
+{
   FFmpegDecoderInstance* working_instance = nullptr;
   FFmpegFramePool::ElementPtr return_frame = nullptr;
+  bool can_spawn = true;
 
   // Find instance
   do {
     QMutexLocker list_locker(&instance_map_lock_);
 
-    QList<FFmpegDecoderInstance*> non_ideal_contenders;
+    InstancePool& pool = instance_pools_[stream().get()];
 
-    QList<FFmpegDecoderInstance*> instances = instance_map_.value(stream().get());
+    // Idle instances are left LOCKED in this list in case we end up using them
+    QList<FFmpegDecoderInstance*> idle_instances;
 
-    foreach (FFmpegDecoderInstance* i, instances) {
+    // The idle instance that can reach the target by decoding the least frames without seeking
+    FFmpegDecoderInstance* nearest_instance = nullptr;
+    int64_t nearest_distance = 0;
 
-      i->cache_lock()->lock();
+    // A working instance that is, or could soon be, decoding towards our target (left LOCKED)
+    FFmpegDecoderInstance* wait_instance = nullptr;
+    bool wait_instance_will_contain = false;
 
-      if (i->CacheContainsTime(target_ts)) {
+    foreach (FFmpegDecoderInstance* i, pool.instances) {
 
-        // Found our instance, allow others to enter the list
+      i->cache_lock()->lock();
 
-        list_locker.unlock();
+      if (i->CacheContainsTime(target_ts)) {
 
-        // Get the frame from this cache
+        // Get the frame from this cache and allow it to continue
         return_frame = i->GetFrameFromCache(target_ts);
-
-        // Got our frame, allow cache to continue
         i->cache_lock()->unlock();
         break;
 
-      } else if (i->CacheWillContainTime(target_ts) || i->CacheCouldContainTime(target_ts)) {
-
-        // Found our instance, allow others to enter the list
-        list_locker.unlock();
-
-        // If the instance is currently in use, enter into a loop of seeing from frames come up next in case one is ours
-        if (i->IsWorking()) {
-
-          do {
-            // Allow instance to continue to the next frame
-            i->cache_wait_cond()->wait(i->cache_lock());
+      } else if (i->IsWorking()) {
 
-            // See if the cache now contains this frame, if so we'll exit this loop
-            if (i->CacheContainsTime(target_ts)) {
+        bool will_contain = i->CacheWillContainTime(target_ts);
 
-              // Grab the frame
-              return_frame = i->GetFrameFromCache(target_ts);
+        if ((will_contain && !wait_instance_will_contain)
+            || (!wait_instance && i->CacheCouldContainTime(target_ts))) {
+          if (wait_instance) {
+            wait_instance->cache_lock()->unlock();
+          }
 
-              // We can release this worker now since we don't need it anymore
-              i->cache_lock()->unlock();
+          wait_instance = i;
+          wait_instance_will_contain = will_contain;
+        } else {
+          // Ignore currently working instances
+          i->cache_lock()->unlock();
+        }
 
-            } else if (!i->IsWorking()) {
+      } else {
 
-              // This instance finished and we didn't get our frame, we'll take it and continue it
-              working_instance = i;
-              break;
+        int64_t distance = i->GetForwardDistance(target_ts);
 
-            }
-          } while (!return_frame);
+        if (distance >= 0 && (!nearest_instance || distance < nearest_distance)) {
+          nearest_instance = i;
+          nearest_distance = distance;
+        }
 
+        // Prioritize empty caches over others in case every instance needs to seek
+        if (i->CacheIsEmpty()) {
+          idle_instances.prepend(i);
         } else {
-          // Otherwise, we'll grab this instance and continue it ourselves
-          working_instance = i;
+          idle_instances.append(i);
         }
 
-        break;
+      }
+    }
 
-      } else if (i->IsWorking()) {
+    if (!return_frame) {
+      if (wait_instance_will_contain) {
+        // This instance is already decoding towards our frame, there's no better choice
+        working_instance = wait_instance;
+      } else if (nearest_instance) {
+        working_instance = nearest_instance;
+      } else if (wait_instance) {
+        working_instance = wait_instance;
+      } else if (!idle_instances.isEmpty() && (!can_spawn || pool.instances.size() >= pool.decoder_count)) {
+        // Every instance would have to seek and we can't open any more, use the least useful one
+        working_instance = idle_instances.first();
+      }
+    }
 
-        // Ignore currently working instances
-        i->cache_lock()->unlock();
+    // Unlock every instance we're not going to use
+    foreach (FFmpegDecoderInstance* unsuitable_instance, idle_instances) {
+      if (unsuitable_instance != working_instance) {
+        unsuitable_instance->cache_lock()->unlock();
+      }
+    }
+
+    if (wait_instance && wait_instance != working_instance) {
+      wait_instance->cache_lock()->unlock();
+    }
 
-      } else if (i->CacheIsEmpty()) {
+    bool spawn_instance = (can_spawn && !return_frame && !working_instance && pool.instances.size() < pool.decoder_count);
 
-        // Prioritize this cache over others (leaves this instance LOCKED in case we end up using it later)
-        non_ideal_contenders.prepend(i);
+    // Allow others to enter the list
+    list_locker.unlock();
 
-      } else {
+    if (spawn_instance) {
 
-        // De-prioritize this cache (leaves this instance LOCKED in case we end up using it later)
-        non_ideal_contenders.append(i);
+      // Every instance is busy elsewhere or would have to seek, so open another one for this request
+      working_instance = SpawnInstance();
 
+      if (!working_instance) {
+        // Don't keep trying, make do with the instances we have
+        can_spawn = false;
       }
-    }
 
-    // If we didn't find a suitable contender, grab the first non-suitable and roll with that
-    if (!return_frame && !working_instance && !non_ideal_contenders.isEmpty()) {
-      working_instance = non_ideal_contenders.takeFirst();
-    }
+    } else if (working_instance && working_instance == wait_instance && working_instance->IsWorking()) {
+
+      // Wait for frames to come up in case one is ours
+      FFmpegDecoderInstance* i = working_instance;
+      working_instance = nullptr;
+
+      do {
+        // Allow instance to continue to the next frame
+        i->cache_wait_cond()->wait(i->cache_lock());
+
+        // See if the cache now contains this frame, if so we'll exit this loop
+        if (i->CacheContainsTime(target_ts)) {
+
+          // Grab the frame
+          return_frame = i->GetFrameFromCache(target_ts);
+
+          // We can release this worker now since we don't need it anymore
+          i->cache_lock()->unlock();
+
+        } else if (!i->IsWorking()) {
+
+          // This instance finished and we didn't get our frame, we'll take it and continue it
+          working_instance = i;
+
+        }
+      } while (!return_frame && !working_instance);
 
-    // For all instances we left locked but didn't end up using, lock them now
-    foreach (FFmpegDecoderInstance* unsuitable_instance, non_ideal_contenders) {
-      unsuitable_instance->cache_lock()->unlock();
     }
   } while (!return_frame && !working_instance);
 
@@ -293,52 +533,33 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divid
     working_instance->cache_lock()->unlock();
   }
 
-  // We found the frame, we'll return a copy
-  if (return_frame) {
-    if (divider != scale_divider_) {
-      FreeScaler();
-      InitScaler(divider);
-    }
+  return return_frame;
+}
 
-    VideoStream* vs = static_cast<VideoStream*>(stream().get());
+FFmpegDecoderInstance *FFmpegDecoder::SpawnInstance()
+{
+  QByteArray fn_bytes = stream()->footage()->filename().toUtf8();
 
-    // Create frame to return
-    FramePtr copy = Frame::Create();
-    copy->set_video_params(VideoRenderingParams(GetScaledDimension(vs->width(), divider),
-                                                GetScaledDimension(vs->height(), divider),
-                                                native_pix_fmt_));
-    copy->set_timestamp(Timecode::timestamp_to_time(target_ts, time_base_));
-    copy->set_sample_aspect_ratio(aspect_ratio_);
-    copy->allocate();
+  FFmpegDecoderInstance* instance = new FFmpegDecoderInstance(fn_bytes.constData(), stream()->index());
 
-    // Align buffer to data/linesize points that can be passed to sws_scale
-    uint8_t* input_data[4];
-    int input_linesize[4];
+  if (!instance->IsValid()) {
+    delete instance;
+    return nullptr;
+  }
 
-    av_image_fill_arrays(input_data,
-                         input_linesize,
-                         reinterpret_cast<const uint8_t*>(return_frame->data()),
-                         src_pix_fmt_,
-                         vs->width(),
-                         vs->height(),
-                         1);
+  // Lock the instance before anyone else can see it so it's ours to use
+  instance->cache_lock()->lock();
 
-    // Convert frame to RGB/A for the rest of the pipeline
-    uint8_t* output_data = reinterpret_cast<uint8_t*>(copy->data());
-    int output_linesize = copy->linesize_bytes();
+  QMutexLocker l(&instance_map_lock_);
 
-    sws_scale(scale_ctx_,
-              input_data,
-              input_linesize,
-              0,
-              vs->height(),
-              &output_data,
-              &output_linesize);
+  InstancePool& pool = instance_pools_[stream().get()];
 
-    return copy;
-  }
+  instance->SetFramePool(pool.frame_pool);
+  instance->SetPacketIndex(pool.packet_index);
 
-  return nullptr;
+  pool.instances.append(instance);
+
+  return instance;
 }
 
 SampleBufferPtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rational &length, const AudioRenderingParams &params)
@@ -354,15 +575,25 @@ SampleBufferPtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rat
     return nullptr;
   }
 
-  QString wav_fn = GetConformedFilename(params);
-  WaveInput input(wav_fn);
+  WaveInput* input = GetAudioInput(params);
+
+  if (input) {
+    const AudioRenderingParams& input_params = input->params();
+
+    qint64 offset = input_params.time_to_bytes(timecode);
+    qint64 byte_length = input_params.time_to_bytes(length);
 
-  if (input.open()) {
-    const AudioRenderingParams& input_params = input.params();
+    if (offset + byte_length > input->data_length()) {
+      // The file may have grown since we mapped it (e.g. it's still being indexed), so map it again
+      input = GetAudioInput(params, true);
+
+      if (!input) {
+        return nullptr;
+      }
+    }
 
-    // Read bytes from wav
-    QByteArray packed_data = input.read(input_params.time_to_bytes(timecode), input_params.time_to_bytes(length));
-    input.close();
+    // Read bytes straight from the mapped wav, they're only copied once while being deinterleaved
+    QByteArray packed_data = input->read_mapped(offset, byte_length);
 
     // Create sample buffer
     SampleBufferPtr sample_buffer = SampleBuffer::CreateFromPackedData(input_params, packed_data);
@@ -370,69 +601,170 @@ SampleBufferPtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rat
     return sample_buffer;
   }
 
-  qCritical() << "Failed to open cached file" << wav_fn;
-
   return nullptr;
 }
 
+WaveInput *FFmpegDecoder::GetAudioInput(const AudioRenderingParams &params, bool reopen)
+{
+  if (audio_input_ && audio_input_params_ == params && !reopen) {
+    return audio_input_.get();
+  }
+
+  QString wav_fn = GetConformedFilename(params);
+
+  audio_input_ = std::unique_ptr<WaveInput>(new WaveInput(wav_fn));
+  audio_input_params_ = params;
+
+  if (!audio_input_->open()) {
+    qCritical() << "Failed to open cached file" << wav_fn;
+    audio_input_ = nullptr;
+  }
+
+  return audio_input_.get();
+}
+
 void FFmpegDecoder::Close()
 {
   QMutexLocker locker(&mutex_);
 
+  if (!open_) {
+    return;
+  }
+
   {
-    // Clear whichever instance is not in use and is least useful (there are only ever as many instances as there are
-    // threads so if this thread is closing, an instance MUST be inactive)
     QMutexLocker l(&instance_map_lock_);
 
-    QList<FFmpegDecoderInstance*> list = instance_map_.value(stream().get());
+    InstancePool& pool = instance_pools_[stream().get()];
 
-    if (!list.isEmpty()) {
-      // Rank the instances by least useful (the top one should be one that isn't working and isn't in use)
-      QList<FFmpegDecoderInstance*> least_useful;
+    pool.decoder_count--;
 
-      foreach (FFmpegDecoderInstance* i, list) {
-        i->cache_lock()->lock();
+    // Retire instances that there's no longer any demand for, starting with the least useful (the top should be one
+    // that isn't working and has nothing cached)
+    QList<FFmpegDecoderInstance*> least_useful;
 
-        if (i->IsWorking()) {
-          // Don't bother any currently working instances
-          i->cache_lock()->unlock();
-          continue;
-        }
+    foreach (FFmpegDecoderInstance* i, pool.instances) {
+      i->cache_lock()->lock();
 
-        if (i->CacheIsEmpty()) {
-          least_useful.prepend(i);
-        } else {
-          least_useful.append(i);
-        }
+      if (i->IsWorking()) {
+        // Don't bother any currently working instances, they'll be retired when the next decoder closes
+        i->cache_lock()->unlock();
+        continue;
       }
 
-      // Remove the least useful from the list and re-insert it into the map
-      FFmpegDecoderInstance* least_useful_instance = least_useful.first();
-      list.removeOne(least_useful_instance);
-      instance_map_.insert(stream().get(), list);
-
-      // If there are no more instances, destroy frame pool
-      if (list.isEmpty()) {
-        FFmpegFramePool* frame_pool = frame_pool_map_.take(stream().get());
-        delete frame_pool;
+      if (i->CacheIsEmpty()) {
+        least_useful.prepend(i);
+      } else {
+        least_useful.append(i);
       }
+    }
 
-      // We're done with the list now, we can unlock it and allow others to use it
-      l.unlock();
+    QList<FFmpegDecoderInstance*> retired;
 
-      // Unlock all the instances we locked
-      foreach (FFmpegDecoderInstance* i, least_useful) {
-        i->cache_lock()->unlock();
-      }
+    while (pool.instances.size() > pool.decoder_count && !least_useful.isEmpty()) {
+      FFmpegDecoderInstance* least_useful_instance = least_useful.takeFirst();
+
+      pool.instances.removeOne(least_useful_instance);
+      pool.retired_seek_count += least_useful_instance->seek_count();
+
+      retired.append(least_useful_instance);
+    }
+
+    // If there are no more instances, destroy frame pool
+    FFmpegFramePool* frame_pool = nullptr;
+
+    if (pool.decoder_count == 0 && pool.instances.isEmpty()) {
+      frame_pool = pool.frame_pool;
+      instance_pools_.remove(stream().get());
+    }
+
+    // We're done with the list now, we can unlock it and allow others to use it
+    l.unlock();
+
+    // Unlock all the instances we locked
+    foreach (FFmpegDecoderInstance* i, least_useful) {
+      i->cache_lock()->unlock();
+    }
 
-      // Delete this least useful instance now that we've definitely taken ownership of it
-      least_useful_instance->deleteLater();
+    // Delete the retired instances now that we've definitely taken ownership of them. Their frames are released now
+    // since the frame pool may be deleted before they are.
+    foreach (FFmpegDecoderInstance* i, retired) {
+      i->ClearFrameCache();
+      i->SetFramePool(nullptr);
+      i->cache_lock()->unlock();
+      i->deleteLater();
     }
+
+    delete frame_pool;
   }
 
   ClearResources();
 }
 
+Decoder *FFmpegDecoder::GetProxyDecoder(int divider)
+{
+  VideoStream* vs = static_cast<VideoStream*>(stream().get());
+
+  int proxy_divider = vs->proxy_divider();
+
+  if (proxy_divider < 1 || divider < proxy_divider || divider % proxy_divider != 0) {
+    return nullptr;
+  }
+
+  VideoStreamPtr proxy_stream = vs->proxy();
+
+  if (!proxy_decoder_ || proxy_decoder_->stream() != proxy_stream) {
+    proxy_decoder_ = Decoder::CreateFromID(proxy_stream->footage()->decoder());
+
+    if (!proxy_decoder_) {
+      return nullptr;
+    }
+
+    proxy_decoder_->set_stream(proxy_stream);
+
+    // Keep the proxy from being evicted from the disk cache while it's in use
+    DiskManager::instance()->Accessed(proxy_stream->footage()->filename());
+  }
+
+  if (!proxy_decoder_->Open()) {
+    qWarning() << "Failed to open proxy for" << stream()->footage()->filename();
+    return nullptr;
+  }
+
+  return proxy_decoder_.get();
+}
+
+int FFmpegDecoder::GetSeekCount()
+{
+  QMutexLocker l(&instance_map_lock_);
+
+  if (!instance_pools_.contains(stream().get())) {
+    return 0;
+  }
+
+  const InstancePool& pool = instance_pools_[stream().get()];
+
+  int count = pool.retired_seek_count;
+
+  foreach (FFmpegDecoderInstance* i, pool.instances) {
+    count += i->seek_count();
+  }
+
+  return count;
+}
+
+qint64 FFmpegDecoder::GetFrameMemoryUsage()
+{
+  QMutexLocker l(&instance_map_lock_);
+
+  if (!instance_pools_.contains(stream().get())) {
+    return 0;
+  }
+
+  FFmpegFramePool* frame_pool = instance_pools_[stream().get()].frame_pool;
+
+  return frame_pool ? frame_pool->GetMemoryUsage() : 0;
+}
+
 QString FFmpegDecoder::id()
 {
   return QStringLiteral("ffmpeg");
@@ -632,15 +964,29 @@ void FFmpegDecoder::Index(const QAtomicInt* cancelled)
     if (QFileInfo::exists(GetIndexFilename())) {
       WaveInput input(GetIndexFilename());
       if (input.open()) {
-        std::static_pointer_cast<AudioStream>(stream())->set_index_done(true);
-        std::static_pointer_cast<AudioStream>(stream())->set_index_length(input.params().bytes_to_time(input.data_length()));
+        rational index_length = input.params().bytes_to_time(input.data_length());
 
         input.close();
+
+        // Indexes from before waveforms were stored per stream won't have one yet
+        GenerateWaveform(cancelled);
+
+        std::static_pointer_cast<AudioStream>(stream())->set_index_done(true);
+        std::static_pointer_cast<AudioStream>(stream())->set_index_length(index_length);
       }
     } else {
       UnconditionalAudioIndex(cancelled);
     }
 
+  } else if (stream()->type() == Stream::kVideo
+             && !std::static_pointer_cast<VideoStream>(stream())->is_image_sequence()) {
+
+    std::shared_ptr<FFmpegPacketIndex> packet_index = std::make_shared<FFmpegPacketIndex>();
+
+    if (packet_index->Load(GetIndexFilename()) || UnconditionalVideoIndex(packet_index.get(), cancelled)) {
+      InstallPacketIndex(packet_index);
+    }
+
   }
 }
 
@@ -756,47 +1102,127 @@ void FFmpegDecoder::UnconditionalAudioIndex(const QAtomicInt* cancelled)
             break;
           }
 
-        } else {
+        } else {
+
+          // No resampling required, we can write directly from the frame buffer
+          data = reinterpret_cast<char*>(frame->data[0]);
+          nb_samples = frame->nb_samples;
+
+        }
+
+        // Write packed WAV data to the disk cache
+        wave_out.write(data, wave_params.samples_to_bytes(nb_samples));
+
+        audio_stream->set_index_length(wave_params.bytes_to_time(wave_out.data_length()));
+
+        // If we allocated an output for the resampler, delete it here
+        if (data != reinterpret_cast<char*>(frame->data[0])) {
+          delete [] data;
+        }
+
+        SignalIndexProgress(frame->pts);
+      }
+    }
+
+    wave_out.close();
+
+    if (success) {
+      GenerateWaveform(cancelled);
+
+      audio_stream->set_index_done(true);
+    } else {
+      // Audio index didn't complete, delete it
+      QFile(GetIndexFilename()).remove();
+      audio_stream->clear_index();
+    }
+  } else {
+    qWarning() << "Failed to open WAVE output for indexing";
+  }
+
+  if (resampler != nullptr) {
+    swr_free(&resampler);
+  }
+
+  av_frame_free(&frame);
+  av_packet_free(&pkt);
+}
+
+bool FFmpegDecoder::UnconditionalVideoIndex(FFmpegPacketIndex *index, const QAtomicInt *cancelled)
+{
+  // Iterate through each packet and store its timestamp, position, and whether it's a keyframe. We only need to demux
+  // for this, not decode, so it's much faster than decoding every frame.
+
+  QByteArray fn_bytes = stream()->footage()->filename().toUtf8();
+
+  FFmpegDecoderInstance index_instance(fn_bytes.constData(), stream()->index());
+
+  if (!index_instance.IsValid()) {
+    return false;
+  }
+
+  AVPacket* pkt = av_packet_alloc();
+  int ret;
+  bool success = false;
+
+  while (true) {
+    // Check if we have a `cancelled` ptr and its value
+    if (cancelled && *cancelled) {
+      break;
+    }
+
+    ret = index_instance.ReadPacket(pkt);
+
+    if (ret < 0) {
 
-          // No resampling required, we can write directly from the frame buffer
-          data = reinterpret_cast<char*>(frame->data[0]);
-          nb_samples = frame->nb_samples;
+      if (ret == AVERROR_EOF) {
+        success = true;
+      } else {
+        char err_str[50];
+        av_strerror(ret, err_str, 50);
+        qWarning() << "Failed to index:" << ret << err_str;
+      }
+      break;
 
-        }
+    }
 
-        // Write packed WAV data to the disk cache
-        wave_out.write(data, wave_params.samples_to_bytes(nb_samples));
+    index->Append(pkt->pts, pkt->pos, pkt->flags & AV_PKT_FLAG_KEY);
 
-        audio_stream->set_index_length(wave_params.bytes_to_time(wave_out.data_length()));
+    SignalIndexProgress(pkt->pts);
 
-        // If we allocated an output for the resampler, delete it here
-        if (data != reinterpret_cast<char*>(frame->data[0])) {
-          delete [] data;
-        }
+    av_packet_unref(pkt);
+  }
 
-        SignalIndexProgress(frame->pts);
-      }
-    }
+  av_packet_free(&pkt);
 
-    wave_out.close();
+  if (success) {
+    index->Finalize();
 
-    if (success) {
-      audio_stream->set_index_done(true);
-    } else {
-      // Audio index didn't complete, delete it
-      QFile(GetIndexFilename()).remove();
-      audio_stream->clear_index();
+    if (!index->Save(GetIndexFilename())) {
+      qWarning() << "Failed to save packet index for" << stream()->footage()->filename();
     }
-  } else {
-    qWarning() << "Failed to open WAVE output for indexing";
   }
 
-  if (resampler != nullptr) {
-    swr_free(&resampler);
+  return success;
+}
+
+void FFmpegDecoder::InstallPacketIndex(FFmpegPacketIndexPtr packet_index)
+{
+  QMutexLocker l(&instance_map_lock_);
+
+  QHash< Stream*, InstancePool >::iterator pool = instance_pools_.find(stream().get());
+
+  if (pool == instance_pools_.end()) {
+    // Stream isn't open, the index will be loaded from disk when it is
+    return;
   }
 
-  av_frame_free(&frame);
-  av_packet_free(&pkt);
+  pool->packet_index = packet_index;
+
+  foreach (FFmpegDecoderInstance* i, pool->instances) {
+    i->cache_lock()->lock();
+    i->SetPacketIndex(packet_index);
+    i->cache_lock()->unlock();
+  }
 }
 
 int FFmpegDecoderInstance::GetFrame(AVPacket *pkt, AVFrame *frame)
@@ -811,13 +1237,7 @@ int FFmpegDecoderInstance::GetFrame(AVPacket *pkt, AVFrame *frame)
   while ((ret = avcodec_receive_frame(codec_ctx_, frame)) == AVERROR(EAGAIN) && !eof) {
 
     // Find next packet in the correct stream index
-    do {
-      // Free buffer in packet if there is one
-      av_packet_unref(pkt);
-
-      // Read packet from file
-      ret = av_read_frame(fmt_ctx_, pkt);
-    } while (pkt->stream_index != avstream_->index && ret >= 0);
+    ret = ReadPacket(pkt);
 
     if (ret == AVERROR_EOF) {
       // Don't break so that receive gets called again, but don't try to read again
@@ -829,6 +1249,15 @@ int FFmpegDecoderInstance::GetFrame(AVPacket *pkt, AVFrame *frame)
       // Handle other error by breaking loop and returning the code we received
       break;
     } else {
+      // If we're only decoding up to a frame, we don't need any frames before it that nothing else refers to
+      if (skip_nonref_before_ != AV_NOPTS_VALUE
+          && pkt->pts != AV_NOPTS_VALUE
+          && pkt->pts < skip_nonref_before_) {
+        codec_ctx_->skip_frame = AVDISCARD_NONREF;
+      } else {
+        codec_ctx_->skip_frame = AVDISCARD_DEFAULT;
+      }
+
       // Successful read, send the packet
       ret = avcodec_send_packet(codec_ctx_, pkt);
 
@@ -844,6 +1273,21 @@ int FFmpegDecoderInstance::GetFrame(AVPacket *pkt, AVFrame *frame)
   return ret;
 }
 
+int FFmpegDecoderInstance::ReadPacket(AVPacket *pkt)
+{
+  int ret;
+
+  do {
+    // Free buffer in packet if there is one
+    av_packet_unref(pkt);
+
+    // Read packet from file
+    ret = av_read_frame(fmt_ctx_, pkt);
+  } while (pkt->stream_index != avstream_->index && ret >= 0);
+
+  return ret;
+}
+
 QMutex *FFmpegDecoderInstance::cache_lock()
 {
   return &cache_lock_;
@@ -864,12 +1308,41 @@ void FFmpegDecoderInstance::SetWorking(bool working)
   is_working_ = working;
 }
 
+int FFmpegDecoderInstance::seek_count() const
+{
+  return seek_count_.load();
+}
+
 void FFmpegDecoderInstance::Seek(int64_t timestamp)
 {
+  seek_count_.fetchAndAddRelaxed(1);
+
+  // The next keyframe we decode starts a new GOP
+  gop_start_ = AV_NOPTS_VALUE;
+
   avcodec_flush_buffers(codec_ctx_);
   av_seek_frame(fmt_ctx_, avstream_->index, timestamp, AVSEEK_FLAG_BACKWARD);
 }
 
+void FFmpegDecoderInstance::SeekToKeyframe(const FFmpegPacketIndex::Keyframe &keyframe)
+{
+  seek_count_.fetchAndAddRelaxed(1);
+
+  gop_start_ = AV_NOPTS_VALUE;
+
+  avcodec_flush_buffers(codec_ctx_);
+
+  // Seeking by byte skips the demuxer's own search for the keyframe
+  if (keyframe.pos >= 0
+      && !(fmt_ctx_->iformat->flags & AVFMT_NO_BYTE_SEEK)
+      && av_seek_frame(fmt_ctx_, avstream_->index, keyframe.pos, AVSEEK_FLAG_BYTE) >= 0) {
+    return;
+  }
+
+  // Otherwise, this exact timestamp should still take us straight to the keyframe
+  av_seek_frame(fmt_ctx_, avstream_->index, keyframe.pts, AVSEEK_FLAG_BACKWARD);
+}
+
 /* OLD UNUSED CODE: Keeping this around in case the code proves useful
 
 void FFmpegDecoder::CacheFrameToDisk(AVFrame *f)
@@ -945,13 +1418,28 @@ FFmpegFramePool::ElementPtr FFmpegDecoderInstance::RetrieveFrame(const int64_t&
 
   cache_target_time_ = target_ts;
 
-  // If the frame wasn't in the frame cache, see if this frame cache is too old to use
-  if (!CacheCouldContainTime(target_ts)) {
+  skip_nonref_before_ = AV_NOPTS_VALUE;
+
+  // If the frame wasn't in the frame cache, see if we can get to it by decoding forward or if we have to seek
+  if (GetForwardDistance(target_ts) < 0) {
     ClearFrameCache();
 
-    Seek(seek_ts);
-    if (seek_ts == 0) {
-      cache_at_zero_ = true;
+    FFmpegPacketIndex::Keyframe keyframe;
+
+    if (packet_index_ && packet_index_->GetKeyframeBefore(target_ts, &keyframe)) {
+      SeekToKeyframe(keyframe);
+
+      // We know exactly which frame we want, so skip anything before it that we don't need to get there
+      skip_nonref_before_ = packet_index_->GetFrameAt(target_ts);
+
+      if (skip_nonref_before_ == packet_index_->first_pts()) {
+        cache_at_zero_ = true;
+      }
+    } else {
+      Seek(seek_ts);
+      if (seek_ts == 0) {
+        cache_at_zero_ = true;
+      }
     }
 
     still_seeking = true;
@@ -997,6 +1485,16 @@ FFmpegFramePool::ElementPtr FFmpegDecoderInstance::RetrieveFrame(const int64_t&
       }
     }
 
+    if (skip_nonref_before_ != AV_NOPTS_VALUE && ret >= 0) {
+      if (working_frame.frame()->pts != AV_NOPTS_VALUE && working_frame.frame()->pts < skip_nonref_before_) {
+        // This frame was only decoded for the frames that refer to it, we don't need to keep it
+        continue;
+      }
+
+      // We've reached our frame, decode normally from here
+      skip_nonref_before_ = AV_NOPTS_VALUE;
+    }
+
     if (cache_is_locked) {
       cache_is_locked = false;
     } else if (unlocked) {
@@ -1008,7 +1506,9 @@ FFmpegFramePool::ElementPtr FFmpegDecoderInstance::RetrieveFrame(const int64_t&
       // Handle an "expected" EOF by using the last frame of our cache
       cache_at_eof_ = true;
 
-      return_frame = cached_frames_.last();
+      if (!cached_frames_.isEmpty()) {
+        return_frame = cached_frames_.last();
+      }
 
       cache_wait_cond_.wakeAll();
       cache_lock_.unlock();
@@ -1023,6 +1523,8 @@ FFmpegFramePool::ElementPtr FFmpegDecoderInstance::RetrieveFrame(const int64_t&
         break;
       }
 
+      ReclaimFrameMemory(static_cast<qint64>(frame_pool_->frame_size()));
+
       FFmpegFramePool::ElementPtr cached = frame_pool_->Get(working_frame.frame());
 
       if (!cached) {
@@ -1034,6 +1536,15 @@ FFmpegFramePool::ElementPtr FFmpegDecoderInstance::RetrieveFrame(const int64_t&
       // Set timestamp so this frame can be identified later
       cached->set_timestamp(working_frame.frame()->pts);
 
+      // Keep track of GOP boundaries so we know when decoding forward is cheaper than seeking
+      if (working_frame.frame()->key_frame) {
+        if (gop_start_ != AV_NOPTS_VALUE && working_frame.frame()->pts > gop_start_) {
+          gop_length_ = qMax(gop_length_, working_frame.frame()->pts - gop_start_);
+        }
+
+        gop_start_ = working_frame.frame()->pts;
+      }
+
       // Store frame before just in case
       FFmpegFramePool::ElementPtr previous;
       if (cached_frames_.isEmpty()) {
@@ -1074,43 +1585,242 @@ FFmpegFramePool::ElementPtr FFmpegDecoderInstance::RetrieveFrame(const int64_t&
   return return_frame;
 }
 
+void FFmpegDecoder::ReadStreamInfo(FFmpegDecoderInstance *instance)
+{
+  if (stream()->type() == Stream::kVideo) {
+    // Get an Olive compatible AVPixelFormat
+    src_pix_fmt_ = static_cast<AVPixelFormat>(instance->stream()->codecpar->format);
+    ideal_pix_fmt_ = FFmpegCommon::GetCompatiblePixelFormat(src_pix_fmt_);
+
+    // Determine which Olive native pixel format we retrieved
+    // Note that FFmpeg doesn't support float formats
+    switch (ideal_pix_fmt_) {
+    case AV_PIX_FMT_RGB24:
+      native_pix_fmt_ = PixelFormat::PIX_FMT_RGB8;
+      break;
+    case AV_PIX_FMT_RGBA:
+      native_pix_fmt_ = PixelFormat::PIX_FMT_RGBA8;
+      break;
+    case AV_PIX_FMT_RGB48:
+      native_pix_fmt_ = PixelFormat::PIX_FMT_RGB16U;
+      break;
+    case AV_PIX_FMT_RGBA64:
+      native_pix_fmt_ = PixelFormat::PIX_FMT_RGBA16U;
+      break;
+    default:
+      // We should never get here, but just in case...
+      qFatal("Invalid output format");
+    }
+
+    aspect_ratio_ = instance->sample_aspect_ratio();
+
+    // See if we can give this footage to the GPU as planar Y'CbCr
+    yuv_pix_fmt_ = FFmpegCommon::GetCompatiblePlanarYUVFormat(src_pix_fmt_);
+
+    if (yuv_pix_fmt_ != AV_PIX_FMT_NONE) {
+      AVCodecParameters* codecpar = instance->stream()->codecpar;
+
+      switch (codecpar->color_space) {
+      case AVCOL_SPC_BT470BG:
+      case AVCOL_SPC_SMPTE170M:
+        yuv_color_matrix_ = YUVFrame::kRec601;
+        break;
+      case AVCOL_SPC_BT2020_NCL:
+      case AVCOL_SPC_BT2020_CL:
+        yuv_color_matrix_ = YUVFrame::kRec2020;
+        break;
+      case AVCOL_SPC_BT709:
+        yuv_color_matrix_ = YUVFrame::kRec709;
+        break;
+      default:
+        // Unspecified, guess from the resolution like most players do
+        yuv_color_matrix_ = (codecpar->height > 576) ? YUVFrame::kRec709 : YUVFrame::kRec601;
+      }
+
+      yuv_full_range_ = (codecpar->color_range == AVCOL_RANGE_JPEG
+                         || src_pix_fmt_ == AV_PIX_FMT_YUVJ420P
+                         || src_pix_fmt_ == AV_PIX_FMT_YUVJ422P
+                         || src_pix_fmt_ == AV_PIX_FMT_YUVJ444P);
+    }
+  }
+
+  time_base_ = instance->stream()->time_base;
+  start_time_ = instance->stream()->start_time;
+}
+
 void FFmpegDecoder::ClearResources()
 {
-  FreeScaler();
+  FreeScalers();
+
+  output_frames_.clear();
+
+  proxy_decoder_ = nullptr;
+
+  audio_input_ = nullptr;
 
   open_ = false;
 }
 
-void FFmpegDecoder::InitScaler(int divider)
+const QVector<FFmpegDecoder::ScalerSlice> &FFmpegDecoder::GetScaler(int divider)
 {
+  QHash< int, QVector<ScalerSlice> >::const_iterator existing = scalers_.constFind(divider);
+
+  if (existing != scalers_.constEnd()) {
+    return existing.value();
+  }
+
   VideoStream* vs = static_cast<VideoStream*>(stream().get());
 
-  scale_ctx_ = sws_getContext(vs->width(),
-                              vs->height(),
-                              src_pix_fmt_,
-                              GetScaledDimension(vs->width(), divider),
-                              GetScaledDimension(vs->height(), divider),
-                              ideal_pix_fmt_,
-                              SWS_FAST_BILINEAR,
-                              nullptr,
-                              nullptr,
-                              nullptr);
+  int dst_width = GetScaledDimension(vs->width(), divider);
+  int dst_height = GetScaledDimension(vs->height(), divider);
+
+  // Slices must start on a row that has its own chroma samples
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(src_pix_fmt_);
+  int row_alignment = 1 << desc->log2_chroma_h;
+
+  int slice_count = qBound(1, dst_height / kMinimumSliceHeight, QThread::idealThreadCount());
+  int slice_height = qCeil(static_cast<double>(dst_height) / static_cast<double>(slice_count) / row_alignment) * row_alignment;
+
+  // Keep the overlap on chroma row boundaries too so every slice's source starts on a row with its own chroma samples
+  int overlap = ((kSliceOverlap + row_alignment - 1) / row_alignment) * row_alignment;
+
+  QVector<ScalerSlice> slices;
+
+  for (int dst_y=0; dst_y<dst_height; dst_y+=slice_height) {
+    ScalerSlice slice;
+
+    bool last_slice = (dst_y + slice_height >= dst_height);
+
+    slice.dst_y = dst_y;
+    slice.dst_height = last_slice ? dst_height - dst_y : slice_height;
+
+    int overlap_above = qMin(overlap, dst_y);
+    int overlap_below = qMin(overlap, dst_height - dst_y - slice.dst_height);
+
+    slice.scaled_offset = overlap_above;
+    slice.scaled_height = overlap_above + slice.dst_height + overlap_below;
+
+    slice.src_y = (dst_y - overlap_above) * divider;
+
+    if (last_slice) {
+      // The last slice also takes any source rows left over from the divider
+      slice.src_height = vs->height() - slice.src_y;
+    } else {
+      slice.src_height = slice.scaled_height * divider;
+    }
+
+    slice.context = sws_getContext(vs->width(),
+                                   slice.src_height,
+                                   src_pix_fmt_,
+                                   dst_width,
+                                   slice.scaled_height,
+                                   ideal_pix_fmt_,
+                                   SWS_FAST_BILINEAR,
+                                   nullptr,
+                                   nullptr,
+                                   nullptr);
+
+    if (!slice.context) {
+      foreach (const ScalerSlice& s, slices) {
+        sws_freeContext(s.context);
+      }
+
+      slices.clear();
+      break;
+    }
 
-  if (scale_ctx_) {
-    scale_divider_ = divider;
+    slices.append(slice);
+  }
+
+  if (slices.isEmpty()) {
+    // Don't cache a failure
+    static const QVector<ScalerSlice> empty;
+    return empty;
+  }
+
+  return scalers_.insert(divider, slices).value();
+}
+
+void FFmpegDecoder::FreeScalers()
+{
+  foreach (SwsContext* scaler, yuv_scalers_) {
+    sws_freeContext(scaler);
+  }
+
+  yuv_scalers_.clear();
+
+  foreach (const QVector<ScalerSlice>& scaler, scalers_) {
+    foreach (const ScalerSlice& slice, scaler) {
+      sws_freeContext(slice.context);
+    }
+  }
+
+  scalers_.clear();
+}
+
+void FFmpegDecoder::ScaleSlice(const ScalerSlice &slice, uint8_t **input_data, const int *input_linesize, uint8_t *output_data, int output_linesize)
+{
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(src_pix_fmt_);
+
+  // Offset each plane to the first row of this slice, the chroma planes (1 and 2) may have fewer rows than the others
+  const uint8_t* slice_input[4];
+
+  for (int i=0;i<4;i++) {
+    if (input_data[i]) {
+      int plane_y = (i == 1 || i == 2) ? (slice.src_y >> desc->log2_chroma_h) : slice.src_y;
+
+      slice_input[i] = input_data[i] + plane_y * input_linesize[i];
+    } else {
+      slice_input[i] = nullptr;
+    }
+  }
+
+  if (slice.scaled_height == slice.dst_height) {
+    // No overlap (the image is a single slice), scale straight into the output
+    uint8_t* slice_output = output_data + slice.dst_y * output_linesize;
+
+    sws_scale(slice.context,
+              slice_input,
+              input_linesize,
+              0,
+              slice.src_height,
+              &slice_output,
+              &output_linesize);
   } else {
-    scale_divider_ = 0;
+    // The overlap rows belong to neighboring slices, so scale into a scratch buffer and only copy this slice's rows
+    QByteArray scratch(slice.scaled_height * output_linesize, Qt::Uninitialized);
+    uint8_t* scratch_data = reinterpret_cast<uint8_t*>(scratch.data());
+
+    sws_scale(slice.context,
+              slice_input,
+              input_linesize,
+              0,
+              slice.src_height,
+              &scratch_data,
+              &output_linesize);
+
+    memcpy(output_data + slice.dst_y * output_linesize,
+           scratch_data + slice.scaled_offset * output_linesize,
+           static_cast<size_t>(slice.dst_height * output_linesize));
   }
 }
 
-void FFmpegDecoder::FreeScaler()
+FramePtr FFmpegDecoder::GetOutputFrame()
 {
-  if (scale_ctx_) {
-    sws_freeContext(scale_ctx_);
-    scale_ctx_ = nullptr;
+  // If we hold the only reference to a frame, whoever we returned it to is done with it
+  foreach (const FramePtr& f, output_frames_) {
+    if (f.use_count() == 1) {
+      return f;
+    }
+  }
 
-    scale_divider_ = 0;
+  FramePtr f = Frame::Create();
+
+  if (output_frames_.size() < kMaxOutputFrames) {
+    output_frames_.append(f);
   }
+
+  return f;
 }
 
 int64_t FFmpegDecoderInstance::RangeStart() const
@@ -1144,7 +1854,56 @@ bool FFmpegDecoderInstance::CacheWillContainTime(const int64_t &t) const
 
 bool FFmpegDecoderInstance::CacheCouldContainTime(const int64_t &t) const
 {
-  return !cached_frames_.isEmpty() && t >= cached_frames_.first()->timestamp() && t <= (cache_target_time_ + 2*second_ts_);
+  return !cached_frames_.isEmpty()
+      && t >= cached_frames_.first()->timestamp()
+      && ForwardDistanceFrom(qMax(RangeEnd(), cache_target_time_), t) >= 0;
+}
+
+int64_t FFmpegDecoderInstance::GetForwardDistance(const int64_t &t) const
+{
+  if (cached_frames_.isEmpty()) {
+    return -1;
+  }
+
+  if (CacheContainsTime(t)) {
+    return 0;
+  }
+
+  if (t < RangeStart()) {
+    // Decoders can't go backwards without seeking
+    return -1;
+  }
+
+  return ForwardDistanceFrom(RangeEnd(), t);
+}
+
+int64_t FFmpegDecoderInstance::ForwardDistanceFrom(const int64_t &position, const int64_t &t) const
+{
+  int64_t distance = qMax(static_cast<int64_t>(0), t - position);
+
+  if (packet_index_) {
+    // We know exactly where the keyframes are, so only seek if there's a keyframe between us and t
+    FFmpegPacketIndex::Keyframe keyframe;
+
+    if (!packet_index_->GetKeyframeBefore(t, &keyframe) || keyframe.pts <= position) {
+      return distance;
+    }
+
+    return -1;
+  }
+
+  // If t is in the GOP we're decoding, seeking would only land us on the keyframe we've already decoded past
+  if (gop_start_ != AV_NOPTS_VALUE && gop_length_ > 0 && t < gop_start_ + gop_length_) {
+    return distance;
+  }
+
+  // Otherwise, only decode forward if it's likely cheaper than decoding up to t from its keyframe after a seek
+  // FIXME: Hardcoded value (assumes GOPs of at most 2 seconds until we've seen one)
+  if (distance <= qMax(gop_length_, 2*second_ts_)) {
+    return distance;
+  }
+
+  return -1;
 }
 
 bool FFmpegDecoderInstance::CacheIsEmpty() const
@@ -1196,6 +1955,55 @@ void FFmpegDecoderInstance::RemoveFramesBefore(const qint64 &t)
   }
 }
 
+void FFmpegDecoderInstance::ReclaimFrameMemory(qint64 needed)
+{
+  qint64 limit = FFmpegFramePool::MemoryLimit();
+
+  if (FFmpegFramePool::GetTotalMemoryUsage() + needed <= limit) {
+    return;
+  }
+
+  QMutexLocker locker(&all_instances_lock_);
+
+  // Lock every cache we can without waiting. Our own cache is already locked, and waiting for others could deadlock
+  // with an instance doing the same thing.
+  QList<FFmpegDecoderInstance*> locked;
+
+  foreach (FFmpegDecoderInstance* i, all_instances_) {
+    if (i == this || i->cache_lock()->tryLock()) {
+      locked.append(i);
+    }
+  }
+
+  while (FFmpegFramePool::GetTotalMemoryUsage() + needed > limit) {
+    // Find the least recently accessed frame that's at the start of a cache
+    FFmpegDecoderInstance* oldest = nullptr;
+
+    foreach (FFmpegDecoderInstance* i, locked) {
+      // We keep one frame in memory as an identifier for what pts the decoder is up to
+      if (i->cached_frames_.size() > 1
+          && (!oldest
+              || i->cached_frames_.first()->last_accessed() < oldest->cached_frames_.first()->last_accessed())) {
+        oldest = i;
+      }
+    }
+
+    if (!oldest) {
+      // Nothing left that we can free
+      break;
+    }
+
+    oldest->cached_frames_.removeFirst();
+    oldest->cache_at_zero_ = false;
+  }
+
+  foreach (FFmpegDecoderInstance* i, locked) {
+    if (i != this) {
+      i->cache_lock()->unlock();
+    }
+  }
+}
+
 void FFmpegDecoderInstance::TruncateCacheRangeTo(const qint64 &t)
 {
   // We keep one frame in memory as an identifier for what pts the decoder is up to
@@ -1219,11 +2027,19 @@ FFmpegDecoderInstance::FFmpegDecoderInstance(const char *filename, int stream_in
   fmt_ctx_(nullptr),
   opts_(nullptr),
   frame_pool_(nullptr),
+  skip_nonref_before_(AV_NOPTS_VALUE),
+  gop_start_(AV_NOPTS_VALUE),
+  gop_length_(0),
   is_working_(false),
   cache_at_zero_(false),
   cache_at_eof_(false),
   clear_timer_(nullptr)
 {
+  {
+    QMutexLocker locker(&all_instances_lock_);
+    all_instances_.append(this);
+  }
+
   // Open file in a format context
   int error_code = avformat_open_input(&fmt_ctx_, filename, nullptr, nullptr);
 
@@ -1307,6 +2123,11 @@ FFmpegDecoderInstance::FFmpegDecoderInstance(const char *filename, int stream_in
 
 FFmpegDecoderInstance::~FFmpegDecoderInstance()
 {
+  {
+    QMutexLocker locker(&all_instances_lock_);
+    all_instances_.removeOne(this);
+  }
+
   ClearResources();
 }
 
@@ -1320,6 +2141,11 @@ void FFmpegDecoderInstance::SetFramePool(FFmpegFramePool *frame_pool)
   frame_pool_ = frame_pool;
 }
 
+void FFmpegDecoderInstance::SetPacketIndex(FFmpegPacketIndexPtr packet_index)
+{
+  packet_index_ = packet_index;
+}
+
 void FFmpegDecoderInstance::ClearResources()
 {
   ClearFrameCache();
@@ -1357,7 +2183,14 @@ void FFmpegDecoderInstance::ClearResources()
 void FFmpegDecoderInstance::ClearTimerEvent()
 {
   cache_lock()->lock();
-  RemoveFramesBefore(QDateTime::currentMSecsSinceEpoch() - kMaxFrameLife);
+
+  RemoveFramesBefore(FFmpegFramePool::Element::Now() - kMaxFrameLife);
+
+  // Give memory back from arenas that have stayed empty since the last time we were here
+  if (frame_pool_) {
+    frame_pool_->ShrinkIdleArenas(kMaxFrameLife);
+  }
+
   cache_lock()->unlock();
 }
 
@@ -35,8 +35,10 @@ extern "C" {
 #include "audio/sampleformat.h"
 #include "avframeptr.h"
 #include "codec/decoder.h"
+#include "codec/waveinput.h"
 #include "codec/waveoutput.h"
 #include "ffmpegframepool.h"
+#include "ffmpegpacketindex.h"
 #include "project/item/footage/videostream.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -53,12 +55,22 @@ public:
 
   void SetFramePool(FFmpegFramePool* frame_pool);
 
+  /**
+   * @brief Set the packet index used to seek directly to keyframes (must be called with the cache locked)
+   */
+  void SetPacketIndex(FFmpegPacketIndexPtr packet_index);
+
   int64_t RangeStart() const;
   int64_t RangeEnd() const;
   bool CacheContainsTime(const int64_t& t) const;
   bool CacheWillContainTime(const int64_t& t) const;
   bool CacheCouldContainTime(const int64_t& t) const;
   bool CacheIsEmpty() const;
+
+  /**
+   * @brief Returns how far this instance must decode forward to reach a timestamp, or -1 if it would need to seek
+   */
+  int64_t GetForwardDistance(const int64_t& t) const;
   FFmpegFramePool::ElementPtr GetFrameFromCache(const int64_t& t) const;
 
   void RemoveFramesBefore(const qint64& t);
@@ -80,17 +92,49 @@ public:
    */
   int GetFrame(AVPacket* pkt, AVFrame* frame);
 
+  /**
+   * @brief Read the next packet of this stream from the file without decoding it
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int ReadPacket(AVPacket* pkt);
+
   QMutex* cache_lock();
   QWaitCondition* cache_wait_cond();
 
   bool IsWorking() const;
   void SetWorking(bool working);
 
+  /**
+   * @brief Number of times this instance has had to seek since it was opened
+   */
+  int seek_count() const;
+
 private:
   void ClearResources();
 
+  /**
+   * @brief Free the least recently accessed frames of every instance until another frame fits in the memory limit
+   *
+   * Must be called with this instance's cache locked. Instances whose caches are locked by another thread are skipped,
+   * and every instance keeps at least one frame, so this may not always be able to get under the limit.
+   */
+  void ReclaimFrameMemory(qint64 needed);
+
   void Seek(int64_t timestamp);
 
+  /**
+   * @brief Seek directly to a keyframe from the packet index, by byte position if the format supports it
+   */
+  void SeekToKeyframe(const FFmpegPacketIndex::Keyframe& keyframe);
+
+  /**
+   * @brief Returns the distance between position and t if decoding forward is cheaper than seeking, or -1 otherwise
+   */
+  int64_t ForwardDistanceFrom(const int64_t& position, const int64_t& t) const;
+
   AVFormatContext* fmt_ctx_;
   AVCodecContext* codec_ctx_;
   AVStream* avstream_;
@@ -103,8 +147,21 @@ private:
   QList<FFmpegFramePool::ElementPtr> cached_frames_;
   FFmpegFramePool* frame_pool_;
 
+  FFmpegPacketIndexPtr packet_index_;
+
+  // Non-reference frames before this timestamp aren't decoded and no frames before it are cached
+  int64_t skip_nonref_before_;
+
   int64_t cache_target_time_;
 
+  // Timestamp of the last keyframe decoded since the last seek
+  int64_t gop_start_;
+
+  // Longest distance between two keyframes observed so far
+  int64_t gop_length_;
+
+  QAtomicInt seek_count_;
+
   bool is_working_;
 
   bool cache_at_zero_;
@@ -113,6 +170,10 @@ private:
   QTimer* clear_timer_;
   static const int kMaxFrameLife;
 
+  // Every instance in existence, used to free frames across streams when the memory limit is reached
+  static QList<FFmpegDecoderInstance*> all_instances_;
+  static QMutex all_instances_lock_;
+
 private slots:
   void ClearTimerEvent();
 
@@ -136,6 +197,7 @@ public:
   virtual bool Open() override;
   virtual RetrieveState GetRetrieveState(const rational &time) override;
   virtual FramePtr RetrieveVideo(const rational &timecode, const int& divider) override;
+  virtual YUVFramePtr RetrieveVideoYUV(const rational &timecode, const int& divider) override;
   virtual SampleBufferPtr RetrieveAudio(const rational &timecode, const rational &length, const AudioRenderingParams& params) override;
   virtual void Close() override;
 
@@ -146,6 +208,16 @@ public:
 
   virtual void Index(const QAtomicInt *cancelled) override;
 
+  /**
+   * @brief Total number of seeks performed by every decoder instance of this stream, including retired ones
+   */
+  int GetSeekCount();
+
+  /**
+   * @brief Bytes of decoded frames currently held for this stream by every decoder instance
+   */
+  qint64 GetFrameMemoryUsage();
+
 private:
   /**
    * @brief Handle an error
@@ -170,25 +242,128 @@ private:
 
   void UnconditionalAudioIndex(const QAtomicInt* cancelled);
 
+  bool UnconditionalVideoIndex(FFmpegPacketIndex* index, const QAtomicInt* cancelled);
+
+  /**
+   * @brief Give a packet index to every instance of this stream and any instances opened later
+   */
+  void InstallPacketIndex(FFmpegPacketIndexPtr packet_index);
+
   void ClearResources();
 
-  void InitScaler(int divider);
-  void FreeScaler();
+  /**
+   * @brief Get the decoded frame at this timestamp from whichever instance is best suited to retrieving it
+   */
+  FFmpegFramePool::ElementPtr RetrieveFrameFromInstances(const int64_t& target_ts);
+
+  /**
+   * @brief Store the format information of this stream from an opened instance
+   */
+  void ReadStreamInfo(FFmpegDecoderInstance* instance);
+
+  /**
+   * @brief Open another instance of this stream to serve requests that no existing instance can reach without seeking
+   *
+   * Returns the new instance already marked as working and with its cache locked, or nullptr if it couldn't be opened.
+   */
+  FFmpegDecoderInstance* SpawnInstance();
+
+  /**
+   * @brief Get a decoder for this stream's proxy if it can serve this divider, opening it if necessary
+   *
+   * Returns nullptr if there's no proxy, if the divider isn't a multiple of the proxy's, or if the proxy failed to
+   * open, in which case the source should be used instead.
+   */
+  Decoder* GetProxyDecoder(int divider);
+
+  /**
+   * @brief Get the WAV file of this audio stream conformed to params
+   *
+   * The file is kept open between calls so it only needs to be found and mapped once. Returns nullptr if it couldn't
+   * be opened.
+   */
+  WaveInput* GetAudioInput(const AudioRenderingParams& params, bool reopen = false);
+
+  /**
+   * @brief A horizontal strip of the image that's converted by its own scaler so strips can be converted in parallel
+   *
+   * Each strip is scaled with a few extra rows above and below it so the scaler's filter sees the same neighbors it
+   * would when scaling the whole image. Those extra rows are discarded afterwards.
+   */
+  struct ScalerSlice {
+    SwsContext* context;
+
+    // Source rows passed to the scaler, including the overlap
+    int src_y;
+    int src_height;
+
+    // Destination rows this slice is responsible for
+    int dst_y;
+    int dst_height;
+
+    // Rows the scaler outputs in total, and how many of those come before dst_y
+    int scaled_height;
+    int scaled_offset;
+  };
+
+  /**
+   * @brief Get the scaler slices for this divider, creating them if they don't exist yet
+   *
+   * Returns an empty list if the scalers couldn't be created.
+   */
+  const QVector<ScalerSlice>& GetScaler(int divider);
+  void FreeScalers();
+
+  void ScaleSlice(const ScalerSlice& slice, uint8_t** input_data, const int* input_linesize, uint8_t* output_data, int output_linesize);
+
+  /**
+   * @brief Get a frame to convert into, reusing a previously returned frame if nothing else holds it anymore
+   */
+  FramePtr GetOutputFrame();
 
   static int GetScaledDimension(int dim, int divider);
 
-  SwsContext* scale_ctx_;
-  int scale_divider_;
+  QHash< int, QVector<ScalerSlice> > scalers_;
+
+  QHash< int, SwsContext* > yuv_scalers_;
+
+  QList<FramePtr> output_frames_;
+
+  static const int kMaxOutputFrames;
+  static const int kMinimumSliceHeight;
+  static const int kSliceOverlap;
+  static const int kFramePoolArenaSize;
   AVPixelFormat src_pix_fmt_;
   AVPixelFormat ideal_pix_fmt_;
   PixelFormat::Format native_pix_fmt_;
 
+  AVPixelFormat yuv_pix_fmt_;
+  YUVFrame::ColorMatrix yuv_color_matrix_;
+  bool yuv_full_range_;
+
   rational time_base_;
   rational aspect_ratio_;
   int64_t start_time_;
 
-  static QHash< Stream*, QList<FFmpegDecoderInstance*> > instance_map_;
-  static QHash< Stream*, FFmpegFramePool* > frame_pool_map_;
+  DecoderPtr proxy_decoder_;
+
+  std::unique_ptr<WaveInput> audio_input_;
+  AudioRenderingParams audio_input_params_;
+
+  /**
+   * @brief Decoder instances shared between every FFmpegDecoder that has a stream open
+   *
+   * Instances are opened on demand, up to one per open decoder, and retired again as decoders close.
+   */
+  struct InstancePool {
+    QList<FFmpegDecoderInstance*> instances;
+    FFmpegFramePool* frame_pool = nullptr;
+    FFmpegPacketIndexPtr packet_index;
+    int decoder_count = 0;
+    int retired_seek_count = 0;
+  };
+
+  static QHash< Stream*, InstancePool > instance_pools_;
   static QMutex instance_map_lock_;
 
 };
@@ -24,14 +24,32 @@ extern "C" {
 #include <libavutil/imgutils.h>
 }
 
+#include "config/config.h"
+
 OLIVE_NAMESPACE_ENTER
 
+QAtomicInteger<qint64> FFmpegFramePool::total_memory_usage_;
+
+// Matches the default "DecoderMemorySize" (2 GB) until UpdateMemoryLimit() is called
+QAtomicInteger<qint64> FFmpegFramePool::memory_limit_(Q_INT64_C(2147483648));
+
 FFmpegFramePool::FFmpegFramePool(int element_count, int width, int height, AVPixelFormat format) :
   MemoryPool(element_count),
   width_(width),
   height_(height),
   format_(format)
 {
+  int buf_sz = av_image_get_buffer_size(format_,
+                                        width_,
+                                        height_,
+                                        1);
+
+  if (buf_sz < 0) {
+    qDebug() << "Failed to find buffer size:" << buf_sz;
+    frame_size_ = 0;
+  } else {
+    frame_size_ = buf_sz;
+  }
 }
 
 FFmpegFramePool::ElementPtr FFmpegFramePool::Get(AVFrame *copy)
@@ -52,19 +70,44 @@ FFmpegFramePool::ElementPtr FFmpegFramePool::Get(AVFrame *copy)
   return ele;
 }
 
+size_t FFmpegFramePool::frame_size() const
+{
+  return frame_size_;
+}
+
+qint64 FFmpegFramePool::GetMemoryUsage() const
+{
+  return static_cast<qint64>(GetElementsInUse()) * static_cast<qint64>(frame_size_);
+}
+
+qint64 FFmpegFramePool::GetTotalMemoryUsage()
+{
+  return total_memory_usage_.load();
+}
+
+qint64 FFmpegFramePool::MemoryLimit()
+{
+  return memory_limit_.load();
+}
+
+void FFmpegFramePool::UpdateMemoryLimit()
+{
+  double gigabytes = Config::Current()["DecoderMemorySize"].toDouble();
+
+  // Convert gigabytes to bytes
+  memory_limit_.store(qRound64(gigabytes * 1073741824));
+}
+
 size_t FFmpegFramePool::GetElementSize()
 {
-  int buf_sz = av_image_get_buffer_size(static_cast<AVPixelFormat>(format_),
-                                        width_,
-                                        height_,
-                                        1);
+  return frame_size_;
+}
 
-  if (buf_sz < 0) {
-    qDebug() << "Failed to find buffer size:" << buf_sz;
-    return 0;
-  }
+void FFmpegFramePool::ElementUsageChanged(int delta)
+{
+  MemoryPool::ElementUsageChanged(delta);
 
-  return buf_sz;
+  total_memory_usage_.fetchAndAddRelaxed(delta * static_cast<qint64>(frame_size_));
 }
 
 OLIVE_NAMESPACE_EXIT
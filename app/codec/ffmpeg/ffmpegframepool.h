@@ -37,16 +37,55 @@ public:
 
   ElementPtr Get(AVFrame* copy);
 
+  /**
+   * @brief Size in bytes of one frame in this pool
+   */
+  size_t frame_size() const;
+
+  /**
+   * @brief Bytes of decoded frames currently held from this pool
+   */
+  qint64 GetMemoryUsage() const;
+
+  /**
+   * @brief Bytes of decoded frames currently held from every frame pool
+   */
+  static qint64 GetTotalMemoryUsage();
+
+  /**
+   * @brief Maximum bytes of decoded frames that should be held across every frame pool
+   *
+   * This is a soft limit, decoders free their least recently accessed frames to stay under it but it can be exceeded
+   * if every remaining frame is in use.
+   */
+  static qint64 MemoryLimit();
+
+  /**
+   * @brief Update MemoryLimit() from the "DecoderMemorySize" config value
+   *
+   * Decoder threads check the limit for every frame, so rather than reading Config from those threads, the limit is
+   * cached. This must be called from the main thread whenever that config value changes.
+   */
+  static void UpdateMemoryLimit();
+
 protected:
   virtual size_t GetElementSize() override;
 
+  virtual void ElementUsageChanged(int delta) override;
+
 private:
+  size_t frame_size_;
+
   int width_;
 
   int height_;
 
   AVPixelFormat format_;
 
+  static QAtomicInteger<qint64> total_memory_usage_;
+
+  static QAtomicInteger<qint64> memory_limit_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,177 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ffmpegpacketindex.h"
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+#include <algorithm>
+#include <cstring>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+OLIVE_NAMESPACE_ENTER
+
+const char FFmpegPacketIndex::kMagic[] = "OVPI";
+const int32_t FFmpegPacketIndex::kVersion = 1;
+
+void FFmpegPacketIndex::Append(int64_t pts, int64_t pos, bool keyframe)
+{
+  packets_.append({pts, pos, keyframe ? kKeyframe : 0, 0});
+}
+
+void FFmpegPacketIndex::Finalize()
+{
+  frames_.clear();
+  keyframes_.clear();
+
+  frames_.reserve(packets_.size());
+
+  foreach (const Packet& p, packets_) {
+    if (p.pts == AV_NOPTS_VALUE) {
+      continue;
+    }
+
+    frames_.append(p.pts);
+
+    if (p.flags & kKeyframe) {
+      keyframes_.append({p.pts, p.pos});
+    }
+  }
+
+  std::sort(frames_.begin(), frames_.end());
+  std::sort(keyframes_.begin(), keyframes_.end(), [](const Keyframe& a, const Keyframe& b){
+    return a.pts < b.pts;
+  });
+}
+
+bool FFmpegPacketIndex::Load(const QString &filename)
+{
+  QFile f(filename);
+
+  if (!f.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  char magic[4];
+  int32_t version;
+  int32_t count;
+
+  if (f.read(magic, sizeof(magic)) != sizeof(magic)
+      || memcmp(magic, kMagic, sizeof(magic)) != 0
+      || f.read(reinterpret_cast<char*>(&version), sizeof(version)) != sizeof(version)
+      || version != kVersion
+      || f.read(reinterpret_cast<char*>(&count), sizeof(count)) != sizeof(count)
+      || count < 0) {
+    return false;
+  }
+
+  qint64 packet_bytes = static_cast<qint64>(count) * static_cast<qint64>(sizeof(Packet));
+
+  if (packet_bytes > f.size() - f.pos()) {
+    // The count doesn't match the file (truncated or corrupt), so don't trust it enough to allocate for it. Returning
+    // false causes the index to be rebuilt.
+    qWarning() << "Invalid packet index:" << filename;
+    return false;
+  }
+
+  packets_.resize(count);
+
+  if (f.read(reinterpret_cast<char*>(packets_.data()), packet_bytes) != packet_bytes) {
+    // Index is truncated, probably because indexing was interrupted
+    packets_.clear();
+    return false;
+  }
+
+  Finalize();
+
+  return true;
+}
+
+bool FFmpegPacketIndex::Save(const QString &filename) const
+{
+  // Write to a temporary file that only replaces the index once it's complete, so a failed or interrupted write never
+  // leaves a plausible-looking index behind
+  QSaveFile f(filename);
+
+  if (!f.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  int32_t count = packets_.size();
+  qint64 packets_size = static_cast<qint64>(count) * static_cast<qint64>(sizeof(Packet));
+
+  if (f.write(kMagic, 4) != 4
+      || f.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion)) != sizeof(kVersion)
+      || f.write(reinterpret_cast<const char*>(&count), sizeof(count)) != sizeof(count)
+      || f.write(reinterpret_cast<const char*>(packets_.constData()), packets_size) != packets_size) {
+    f.cancelWriting();
+    return false;
+  }
+
+  return f.commit();
+}
+
+bool FFmpegPacketIndex::IsEmpty() const
+{
+  return frames_.isEmpty();
+}
+
+bool FFmpegPacketIndex::GetKeyframeBefore(int64_t pts, Keyframe *keyframe) const
+{
+  // Find the first keyframe after pts, the one before it is the one we want
+  QVector<Keyframe>::const_iterator after = std::upper_bound(keyframes_.constBegin(), keyframes_.constEnd(), pts,
+                                                             [](int64_t t, const Keyframe& k){
+    return t < k.pts;
+  });
+
+  if (after == keyframes_.constBegin()) {
+    return false;
+  }
+
+  *keyframe = *(after - 1);
+
+  return true;
+}
+
+int64_t FFmpegPacketIndex::GetFrameAt(int64_t pts) const
+{
+  QVector<int64_t>::const_iterator after = std::upper_bound(frames_.constBegin(), frames_.constEnd(), pts);
+
+  if (after == frames_.constBegin()) {
+    return AV_NOPTS_VALUE;
+  }
+
+  return *(after - 1);
+}
+
+int64_t FFmpegPacketIndex::first_pts() const
+{
+  if (frames_.isEmpty()) {
+    return AV_NOPTS_VALUE;
+  }
+
+  return frames_.first();
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,106 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FFMPEGPACKETINDEX_H
+#define FFMPEGPACKETINDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <QString>
+#include <QVector>
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+class FFmpegPacketIndex;
+using FFmpegPacketIndexPtr = std::shared_ptr<const FFmpegPacketIndex>;
+
+/**
+ * @brief An index of every packet in a stream used to seek straight to the keyframe preceding any frame
+ *
+ * Packets are appended in the order they're read from the file, after which Finalize() must be called before the index
+ * can be queried. Once finalized, an index is never modified again and can be shared between threads.
+ */
+class FFmpegPacketIndex
+{
+public:
+  struct Keyframe {
+    int64_t pts;
+
+    // Byte position of the keyframe's packet in the file, or -1 if the demuxer didn't provide one
+    int64_t pos;
+  };
+
+  FFmpegPacketIndex() = default;
+
+  void Append(int64_t pts, int64_t pos, bool keyframe);
+
+  /**
+   * @brief Sort the packets by presentation time so they can be searched
+   */
+  void Finalize();
+
+  bool Load(const QString& filename);
+  bool Save(const QString& filename) const;
+
+  bool IsEmpty() const;
+
+  /**
+   * @brief Find the last keyframe presented at or before pts
+   *
+   * Returns false if there is no such keyframe.
+   */
+  bool GetKeyframeBefore(int64_t pts, Keyframe* keyframe) const;
+
+  /**
+   * @brief Returns the exact timestamp of the frame presented at pts, or AV_NOPTS_VALUE if pts is before every frame
+   */
+  int64_t GetFrameAt(int64_t pts) const;
+
+  int64_t first_pts() const;
+
+private:
+  struct Packet {
+    int64_t pts;
+    int64_t pos;
+    int32_t flags;
+    int32_t reserved;
+  };
+
+  static const char kMagic[];
+  static const int32_t kVersion;
+
+  enum PacketFlag {
+    kKeyframe = 0x1
+  };
+
+  // Packets in the order they were read from the file
+  QVector<Packet> packets_;
+
+  // Sorted by presentation time
+  QVector<int64_t> frames_;
+  QVector<Keyframe> keyframes_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // FFMPEGPACKETINDEX_H
@@ -20,6 +20,8 @@
 
 #include "samplebuffer.h"
 
+#include "audio/samplekernels.h"
+
 OLIVE_NAMESPACE_ENTER
 
 SampleBuffer::SampleBuffer() :
@@ -59,15 +61,17 @@ SampleBufferPtr SampleBuffer::CreateFromPackedData(const AudioRenderingParams &a
   int samples_per_channel = audio_params.bytes_to_samples(bytes.size());
   SampleBufferPtr buffer = CreateAllocated(audio_params, samples_per_channel);
 
-  int total_samples = samples_per_channel * audio_params.channel_count();
+  int nb_channels = audio_params.channel_count();
 
   const float* packed_data = reinterpret_cast<const float*>(bytes.constData());
 
-  for (int i=0;i<total_samples;i++) {
-    int channel = i % audio_params.channel_count();
-    int index = i / audio_params.channel_count();
+  for (int channel=0;channel<nb_channels;channel++) {
+    float* channel_data = buffer->data_[channel];
+    const float* packed_channel = packed_data + channel;
 
-    buffer->data_[channel][index] = packed_data[i];
+    for (int i=0;i<samples_per_channel;i++) {
+      channel_data[i] = packed_channel[i * nb_channels];
+    }
   }
 
   return buffer;
@@ -155,14 +159,8 @@ void SampleBuffer::reverse()
     return;
   }
 
-  int half_nb_sample = sample_count_per_channel_ / 2;
-
-  for (int i=0;i<half_nb_sample;i++) {
-    int opposite_ind = sample_count_per_channel_ - i - 1;
-
-    for (int j=0;j<audio_params_.channel_count();j++) {
-      std::swap(data_[j][i], data_[j][opposite_ind]);
-    }
+  for (int i=0;i<audio_params_.channel_count();i++) {
+    SampleKernels::Reverse(data_[i], sample_count_per_channel_);
   }
 }
 
@@ -173,24 +171,36 @@ void SampleBuffer::speed(double speed)
     return;
   }
 
-  int max_adjusted_nb_samples = qRound(static_cast<double>(sample_count_per_channel_) * speed);
+  if (speed <= 0.0) {
+    qWarning() << "Tried to speed a sample buffer by a non-positive amount";
+    return;
+  }
 
-  float** input_data = data_;
-  float** output_data;
+  // Every output sample reads `speed` input samples ahead of the last, so the output is 1/speed of the input's length
+  int adjusted_nb_samples = qMax(1, qRound(static_cast<double>(sample_count_per_channel_) / speed));
 
-  allocate_sample_buffer(&output_data, audio_params_.channel_count(), max_adjusted_nb_samples);
+  if (speed >= 1.0) {
+    // Output is never longer than the input and never reads behind where it writes, so we can do this in place. The
+    // allocation will be larger than it needs to be, but that's harmless.
+    for (int i=0;i<audio_params_.channel_count();i++) {
+      SampleKernels::Resample(data_[i], sample_count_per_channel_, data_[i], adjusted_nb_samples, speed);
+    }
+  } else {
+    float** input_data = data_;
+    float** output_data;
 
-  for (int i=0;i<max_adjusted_nb_samples;i++) {
-    int input_index = qRound(static_cast<double>(i) * speed);
+    allocate_sample_buffer(&output_data, audio_params_.channel_count(), adjusted_nb_samples);
 
-    for (int j=0;j<audio_params_.channel_count();j++) {
-      output_data[j][i] = input_data[j][input_index];
+    for (int i=0;i<audio_params_.channel_count();i++) {
+      SampleKernels::Resample(input_data[i], sample_count_per_channel_, output_data[i], adjusted_nb_samples, speed);
     }
-  }
 
-  destroy_sample_buffer(&input_data, audio_params_.channel_count());
+    destroy_sample_buffer(&input_data, audio_params_.channel_count());
 
-  data_ = output_data;
+    data_ = output_data;
+  }
+
+  sample_count_per_channel_ = adjusted_nb_samples;
 }
 
 void SampleBuffer::fill(const float &f)
@@ -240,13 +250,14 @@ QByteArray SampleBuffer::toPackedData() const
 
     float* output_data = reinterpret_cast<float*>(packed_data.data());
 
-    int output_index = 0;
+    int nb_channels = audio_params_.channel_count();
 
-    for (int j=0;j<sample_count_per_channel_;j++) {
-      for (int i=0;i<audio_params_.channel_count();i++) {
-        output_data[output_index] = data_[i][j];
+    for (int i=0;i<nb_channels;i++) {
+      const float* channel_data = data_[i];
+      float* packed_channel = output_data + i;
 
-        output_index++;
+      for (int j=0;j<sample_count_per_channel_;j++) {
+        packed_channel[j * nb_channels] = channel_data[j];
       }
     }
   }
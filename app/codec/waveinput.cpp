@@ -30,7 +30,11 @@ extern "C" {
 OLIVE_NAMESPACE_ENTER
 
 WaveInput::WaveInput(const QString &f) :
-  file_(f)
+  file_(f),
+  map_(nullptr),
+  data_position_(0),
+  data_size_(0),
+  pos_(0)
 {
 }
 
@@ -150,6 +154,17 @@ bool WaveInput::open()
   data_stream >> data_size_;
   data_position_ = file_.pos();
 
+  // The header may claim more data than there is if the file is still being written
+  data_size_ = static_cast<quint32>(qMin(static_cast<qint64>(data_size_), file_.size() - data_position_));
+
+  pos_ = 0;
+
+  map_ = file_.map(0, file_.size());
+
+  if (!map_ && data_size_ > 0) {
+    qWarning() << "Failed to map" << file_.fileName() << "- falling back to regular reads";
+  }
+
   return true;
 }
 
@@ -164,7 +179,19 @@ QByteArray WaveInput::read(int length)
     return QByteArray();
   }
 
-  return file_.read(qMin(calculate_max_read(), static_cast<qint64>(length)));
+  qint64 read_size = qMin(calculate_max_read(), static_cast<qint64>(length));
+
+  QByteArray bytes;
+
+  if (map_) {
+    bytes = QByteArray(mapped_data(), static_cast<int>(read_size));
+  } else {
+    bytes = file_.read(read_size);
+  }
+
+  pos_ += bytes.size();
+
+  return bytes;
 }
 
 QByteArray WaveInput::read(int offset, int length)
@@ -174,7 +201,7 @@ QByteArray WaveInput::read(int offset, int length)
   }
 
   seek(offset);
-  return file_.read(qMin(calculate_max_read(), static_cast<qint64>(length)));
+  return read(length);
 }
 
 qint64 WaveInput::read(int offset, char *buffer, int length)
@@ -184,17 +211,51 @@ qint64 WaveInput::read(int offset, char *buffer, int length)
   }
 
   seek(offset);
-  return file_.read(buffer, qMin(calculate_max_read(), static_cast<qint64>(length)));
+
+  qint64 read_size = qMin(calculate_max_read(), static_cast<qint64>(length));
+
+  if (map_) {
+    memcpy(buffer, mapped_data(), static_cast<size_t>(read_size));
+  } else {
+    read_size = file_.read(buffer, read_size);
+  }
+
+  pos_ += read_size;
+
+  return read_size;
+}
+
+QByteArray WaveInput::read_mapped(int offset, int length)
+{
+  if (!map_) {
+    return read(offset, length);
+  }
+
+  seek(offset);
+
+  qint64 read_size = qMin(calculate_max_read(), static_cast<qint64>(length));
+
+  QByteArray bytes = QByteArray::fromRawData(mapped_data(), static_cast<int>(read_size));
+
+  pos_ += read_size;
+
+  return bytes;
 }
 
 bool WaveInput::seek(qint64 pos)
 {
-  return file_.seek(data_position_ + qMin(pos, static_cast<qint64>(data_size_)));
+  pos_ = qBound(static_cast<qint64>(0), pos, static_cast<qint64>(data_size_));
+
+  if (map_) {
+    return true;
+  }
+
+  return file_.seek(data_position_ + pos_);
 }
 
 bool WaveInput::at_end() const
 {
-  return file_.pos() == (data_position_ + data_size_);
+  return pos_ == data_size_;
 }
 
 const AudioRenderingParams &WaveInput::params() const
@@ -204,6 +265,11 @@ const AudioRenderingParams &WaveInput::params() const
 
 void WaveInput::close()
 {
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+
   if (file_.isOpen()) {
     file_.close();
   }
@@ -236,7 +302,12 @@ bool WaveInput::find_str(QFile *f, const char *str)
 
 qint64 WaveInput::calculate_max_read() const
 {
-  return data_size_ - (file_.pos() - data_position_ );
+  return data_size_ - pos_;
+}
+
+const char *WaveInput::mapped_data() const
+{
+  return reinterpret_cast<const char*>(map_) + data_position_ + pos_;
 }
 
 OLIVE_NAMESPACE_EXIT
@@ -27,6 +27,12 @@
 
 OLIVE_NAMESPACE_ENTER
 
+/**
+ * @brief Reads PCM WAV files
+ *
+ * Sample data is read from a memory mapping of the file so reads don't need a system call each. If the file can't be
+ * mapped, it's read normally instead.
+ */
 class WaveInput
 {
 public:
@@ -44,6 +50,14 @@ public:
   QByteArray read(int offset, int length);
   qint64 read(int offset, char *buffer, int length);
 
+  /**
+   * @brief Read without copying the data
+   *
+   * The returned array refers directly to the mapped file, so it's only valid until the WaveInput is closed. If the
+   * file isn't mapped, this makes a copy like read().
+   */
+  QByteArray read_mapped(int offset, int length);
+
   bool seek(qint64 pos);
 
   bool at_end() const;
@@ -61,13 +75,20 @@ private:
 
   qint64 calculate_max_read() const;
 
+  const char* mapped_data() const;
+
   AudioRenderingParams params_;
 
   QFile file_;
 
+  uchar* map_;
+
   qint64 data_position_;
 
   quint32 data_size_;
+
+  // Read position relative to the start of the sample data
+  qint64 pos_;
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,169 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "yuvframe.h"
+
+#include <QtMath>
+
+OLIVE_NAMESPACE_ENTER
+
+YUVFrame::YUVFrame() :
+  width_(0),
+  height_(0),
+  chroma_shift_x_(0),
+  chroma_shift_y_(0),
+  bytes_per_sample_(1),
+  color_matrix_(kRec709),
+  full_range_(false),
+  sample_aspect_ratio_(1)
+{
+}
+
+YUVFramePtr YUVFrame::Create()
+{
+  return std::make_shared<YUVFrame>();
+}
+
+void YUVFrame::set_format(int width, int height, int chroma_shift_x, int chroma_shift_y, int bytes_per_sample)
+{
+  width_ = width;
+  height_ = height;
+  chroma_shift_x_ = chroma_shift_x;
+  chroma_shift_y_ = chroma_shift_y;
+  bytes_per_sample_ = bytes_per_sample;
+}
+
+const int &YUVFrame::width() const
+{
+  return width_;
+}
+
+const int &YUVFrame::height() const
+{
+  return height_;
+}
+
+const int &YUVFrame::bytes_per_sample() const
+{
+  return bytes_per_sample_;
+}
+
+int YUVFrame::plane_width(int plane) const
+{
+  if (plane == 0) {
+    return width_;
+  }
+
+  // Round up so odd sizes keep their last chroma sample
+  return -((-width_) >> chroma_shift_x_);
+}
+
+int YUVFrame::plane_height(int plane) const
+{
+  if (plane == 0) {
+    return height_;
+  }
+
+  return -((-height_) >> chroma_shift_y_);
+}
+
+int YUVFrame::plane_linesize_samples(int plane) const
+{
+  // Align linesize to 16
+  return qCeil(static_cast<double>(plane_width(plane)) / 16.0) * 16;
+}
+
+int YUVFrame::plane_linesize_bytes(int plane) const
+{
+  return plane_linesize_samples(plane) * bytes_per_sample_;
+}
+
+const YUVFrame::ColorMatrix &YUVFrame::color_matrix() const
+{
+  return color_matrix_;
+}
+
+void YUVFrame::set_color_matrix(const YUVFrame::ColorMatrix &matrix)
+{
+  color_matrix_ = matrix;
+}
+
+const bool &YUVFrame::full_range() const
+{
+  return full_range_;
+}
+
+void YUVFrame::set_full_range(bool full_range)
+{
+  full_range_ = full_range;
+}
+
+const rational &YUVFrame::sample_aspect_ratio() const
+{
+  return sample_aspect_ratio_;
+}
+
+void YUVFrame::set_sample_aspect_ratio(const rational &sample_aspect_ratio)
+{
+  sample_aspect_ratio_ = sample_aspect_ratio;
+}
+
+const rational &YUVFrame::timestamp() const
+{
+  return timestamp_;
+}
+
+void YUVFrame::set_timestamp(const rational &timestamp)
+{
+  timestamp_ = timestamp;
+}
+
+char *YUVFrame::plane_data(int plane)
+{
+  return data_.data() + plane_offset(plane);
+}
+
+const char *YUVFrame::const_plane_data(int plane) const
+{
+  return data_.constData() + plane_offset(plane);
+}
+
+void YUVFrame::allocate()
+{
+  data_.resize(plane_offset(kPlaneCount));
+}
+
+bool YUVFrame::is_allocated() const
+{
+  return !data_.isEmpty();
+}
+
+int YUVFrame::plane_offset(int plane) const
+{
+  int offset = 0;
+
+  for (int i=0;i<plane;i++) {
+    offset += plane_linesize_bytes(i) * plane_height(i);
+  }
+
+  return offset;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,134 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef YUVFRAME_H
+#define YUVFRAME_H
+
+#include <memory>
+#include <QByteArray>
+
+#include "common/rational.h"
+
+OLIVE_NAMESPACE_ENTER
+
+class YUVFrame;
+using YUVFramePtr = std::shared_ptr<YUVFrame>;
+
+/**
+ * @brief Planar Y'CbCr video frame data from a Decoder
+ *
+ * Keeps the frame in the footage's own format so it can be uploaded to the GPU as is (less than half the size of the
+ * same frame as RGBA for 4:2:0) and converted to RGB in a shader. All three planes are stored in one buffer, one after
+ * another.
+ */
+class YUVFrame
+{
+public:
+  enum ColorMatrix {
+    kRec601,
+    kRec709,
+    kRec2020
+  };
+
+  static const int kPlaneCount = 3;
+
+  YUVFrame();
+
+  static YUVFramePtr Create();
+
+  /**
+   * @brief Set the size and format of this frame, must be called before allocate()
+   *
+   * @param chroma_shift_x
+   *
+   * Log2 of the horizontal chroma subsampling, e.g. 1 for 4:2:0 and 4:2:2, 0 for 4:4:4.
+   *
+   * @param chroma_shift_y
+   *
+   * Log2 of the vertical chroma subsampling, e.g. 1 for 4:2:0, 0 for 4:2:2 and 4:4:4.
+   *
+   * @param bytes_per_sample
+   *
+   * 1 for 8-bit samples or 2 for 16-bit samples. Footage of any other bit depth is expected to be converted to one of
+   * these first.
+   */
+  void set_format(int width, int height, int chroma_shift_x, int chroma_shift_y, int bytes_per_sample);
+
+  const int& width() const;
+  const int& height() const;
+  const int& bytes_per_sample() const;
+
+  int plane_width(int plane) const;
+  int plane_height(int plane) const;
+  int plane_linesize_samples(int plane) const;
+  int plane_linesize_bytes(int plane) const;
+
+  const ColorMatrix& color_matrix() const;
+  void set_color_matrix(const ColorMatrix& matrix);
+
+  /**
+   * @brief Whether samples use the full range of values rather than the "TV" range (e.g. 16-235 for 8-bit)
+   */
+  const bool& full_range() const;
+  void set_full_range(bool full_range);
+
+  const rational& sample_aspect_ratio() const;
+  void set_sample_aspect_ratio(const rational& sample_aspect_ratio);
+
+  const rational& timestamp() const;
+  void set_timestamp(const rational& timestamp);
+
+  char* plane_data(int plane);
+  const char* const_plane_data(int plane) const;
+
+  void allocate();
+
+  bool is_allocated() const;
+
+private:
+  int plane_offset(int plane) const;
+
+  QByteArray data_;
+
+  int width_;
+
+  int height_;
+
+  int chroma_shift_x_;
+
+  int chroma_shift_y_;
+
+  int bytes_per_sample_;
+
+  ColorMatrix color_matrix_;
+
+  bool full_range_;
+
+  rational sample_aspect_ratio_;
+
+  rational timestamp_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+Q_DECLARE_METATYPE(OLIVE_NAMESPACE::YUVFramePtr)
+
+#endif // YUVFRAME_H
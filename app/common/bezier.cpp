@@ -26,41 +26,103 @@ OLIVE_NAMESPACE_ENTER
 
 double Bezier::QuadraticXtoT(double x, double a, double b, double c)
 {
-  return (a - b + qSqrt(a*x + c*x - 2*b*x + qPow(b, 2) - a*c))/(a - 2*b + c);
+  double denom = a - 2*b + c;
+
+  if (qFuzzyIsNull(denom)) {
+    // Control point is exactly halfway so the curve is linear in X
+    return (x - a) / (c - a);
+  }
+
+  return (a - b + qSqrt(a*x + c*x - 2*b*x + b*b - a*c))/denom;
 }
 
 double Bezier::QuadraticTtoY(double a, double b, double c, double t)
 {
-  return qPow(1.0 - t, 2)*a + 2*(1.0 - t)*t*b + qPow(t, 2)*c;
+  double inv_t = 1.0 - t;
+
+  return inv_t*inv_t*a + 2*inv_t*t*b + t*t*c;
 }
 
 double Bezier::CubicXtoT(double x_target, double a, double b, double c, double d)
 {
-  double tolerance = 0.0001;
+  const double tolerance = 1e-7;
+  const int max_newton_iterations = 8;
+  const int max_bisect_iterations = 64;
 
+  Cubic curve(a, b, c, d);
+
+  // Start from where the target would be if the curve were linear, which is usually very close already
+  double t = (d == a) ? 0.5 : qBound(0.0, (x_target - a) / (d - a), 1.0);
   double lower = 0.0;
   double upper = 1.0;
 
-  double percent = 0.5;
-  double x = CubicTtoY(a, b, c, d, percent);
+  // Newton-Raphson converges in a few iterations, but it's kept within a bracket so a flat spot in the curve can't
+  // send it outside of 0.0-1.0
+  for (int i=0;i<max_newton_iterations;i++) {
+    double error = curve.Evaluate(t) - x_target;
+
+    if (qAbs(error) <= tolerance) {
+      return t;
+    }
 
-  while (qAbs(x_target - x) > tolerance) {
-    if (x_target > x) {
-      lower = percent;
+    if (error < 0) {
+      lower = t;
     } else {
-      upper = percent;
+      upper = t;
     }
 
-    percent = (upper + lower) / 2.0;
-    x = CubicTtoY(a, b, c, d, percent);
+    double slope = curve.Derivative(t);
+    double next = (qAbs(slope) > 1e-12) ? t - error / slope : lower - 1.0;
+
+    if (next <= lower || next >= upper) {
+      next = (lower + upper) * 0.5;
+    }
+
+    t = next;
   }
 
-  return percent;
+  // If Newton didn't converge, fall back to bisecting what's left of the bracket
+  for (int i=0;i<max_bisect_iterations;i++) {
+    double error = curve.Evaluate(t) - x_target;
+
+    if (qAbs(error) <= tolerance) {
+      break;
+    }
+
+    if (error < 0) {
+      lower = t;
+    } else {
+      upper = t;
+    }
+
+    t = (lower + upper) * 0.5;
+  }
+
+  return t;
 }
 
 double Bezier::CubicTtoY(double a, double b, double c, double d, double t)
 {
-  return qPow(1.0 - t, 3)*a + 3*qPow(1.0 - t, 2)*t*b + 3*(1.0 - t)*qPow(t, 2)*c + qPow(t, 3)*d;
+  return Cubic(a, b, c, d).Evaluate(t);
+}
+
+Bezier::Cubic::Cubic(double a, double b, double c, double d)
+{
+  // Expand the Bernstein form into a plain polynomial so it can be evaluated without any powers
+  c0_ = a;
+  c1_ = 3.0 * (b - a);
+  c2_ = 3.0 * (a - 2.0*b + c);
+  c3_ = d - a + 3.0 * (b - c);
+}
+
+double Bezier::Cubic::Evaluate(double t) const
+{
+  return ((c3_*t + c2_)*t + c1_)*t + c0_;
+}
+
+double Bezier::Cubic::Derivative(double t) const
+{
+  return (3.0*c3_*t + 2.0*c2_)*t + c1_;
 }
 
 OLIVE_NAMESPACE_EXIT
@@ -35,6 +35,28 @@ public:
   static double CubicXtoT(double x_target, double a, double b, double c, double d);
 
   static double CubicTtoY(double a, double b, double c, double d, double t);
+
+private:
+  /**
+   * @brief One dimension of a cubic bezier as polynomial coefficients
+   */
+  class Cubic
+  {
+  public:
+    Cubic(double a, double b, double c, double d);
+
+    double Evaluate(double t) const;
+
+    double Derivative(double t) const;
+
+  private:
+    double c0_;
+    double c1_;
+    double c2_;
+    double c3_;
+
+  };
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -21,11 +21,12 @@
 #ifndef MEMORYPOOL_H
 #define MEMORYPOOL_H
 
+#include <chrono>
 #include <memory>
-#include <QDateTime>
+#include <QAtomicInteger>
 #include <QDebug>
 #include <QLinkedList>
-#include <QMutex>
+#include <QReadWriteLock>
 #include <stdint.h>
 
 #include "common/define.h"
@@ -45,6 +46,9 @@ template <typename T>
  *
  * `Get()` will return an ElementPtr. The original desired data can be accessed through ElementPtr::data(). This data
  * will belong to the caller until ElementPtr goes out of scope and the memory is freed back into the pool.
+ *
+ * Getting and releasing elements is O(1) and doesn't lock anything besides sharing a read lock on the arena list, so
+ * many threads can use the same pool without contending.
  */
 class MemoryPool
 {
@@ -73,25 +77,36 @@ public:
   /**
    * @brief Returns whether any arenas are successfully allocated
    */
-  inline bool IsAllocated() const {
+  inline bool IsAllocated() {
+    QReadLocker locker(&lock_);
     return !arenas_.isEmpty();
   }
 
   /**
    * @brief Returns current number of allocated arenas
    */
-  inline int GetArenaCount() const {
+  inline int GetArenaCount() {
+    QReadLocker locker(&lock_);
     return arenas_.size();
   }
 
+  /**
+   * @brief Returns the number of elements currently lent out across all arenas
+   */
+  inline int GetElementsInUse() const {
+    return elements_in_use_.load();
+  }
+
   class Arena;
+  class ElementPtr;
 
   /**
    * @brief A handle for a chunk of memory in an arena
    *
-   * Calling Get() on the pool or arena will return a shared pointer to an element which will contain a pointer to
-   * the desired object/data in data(). When Element is destroyed (i.e. when ElementPtr goes out of scope), the memory
-   * is released back into the pool so it can be used by another class.
+   * Each arena holds one Element per chunk of memory. Calling Get() on the pool or arena will return an ElementPtr
+   * referencing one, which will contain a pointer to the desired object/data in data(). Elements are reference counted
+   * by ElementPtr, and when the last ElementPtr goes out of scope, the memory is released back into the pool so it can
+   * be used by another class.
    */
   class Element {
   public:
@@ -100,19 +115,13 @@ public:
      *
      * There is no need to use this outside of the memory pool's internal functions.
      */
-    Element(Arena* parent, T* data) {
-      parent_ = parent;
-      data_ = data;
-      accessed_ = QDateTime::currentMSecsSinceEpoch();
-    }
-
-    /**
-     * @brief Element Destructor
-     *
-     * Automatically releases this element's memory back to the arena it was retrieved from.
-     */
-    ~Element() {
-      parent_->Release(this);
+    Element() :
+      parent_(nullptr),
+      data_(nullptr),
+      index_(0),
+      timestamp_(0),
+      accessed_(0)
+    {
     }
 
     DISABLE_COPY_MOVE(Element)
@@ -138,7 +147,7 @@ public:
      * \see last_accessed()
      */
     inline void access() {
-      accessed_ = QDateTime::currentMSecsSinceEpoch();
+      accessed_ = Now();
     }
 
     /**
@@ -146,23 +155,152 @@ public:
      *
      * Useful for determining the relative age of an element (i.e. if it hasn't been accessed for a certain amount of
      * time, it can probably be freed back into the pool). This requires all usages to call `access()`.
+     *
+     * The time is in milliseconds on the same clock as Now().
      */
     inline const int64_t& last_accessed() const {
       return accessed_;
     }
 
+    /**
+     * @brief Current time in milliseconds on the clock used for access times
+     *
+     * This is a monotonic clock with an arbitrary epoch, so it's only useful for comparing against last_accessed().
+     */
+    static inline int64_t Now() {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
   private:
+    friend class Arena;
+    friend class ElementPtr;
+
+    inline void ref() {
+      ref_.ref();
+    }
+
+    inline void deref() {
+      if (!ref_.deref()) {
+        parent_->Release(this);
+      }
+    }
+
     Arena* parent_;
 
     T* data_;
 
+    int index_;
+
     int64_t timestamp_;
 
     int64_t accessed_;
 
+    QAtomicInt ref_;
+
   };
 
-  using ElementPtr = std::shared_ptr<Element>;
+  /**
+   * @brief Reference counted handle to an Element
+   *
+   * Works like a shared pointer, but the count is stored in the Element itself so no allocation is made per Get().
+   */
+  class ElementPtr {
+  public:
+    ElementPtr() :
+      element_(nullptr)
+    {
+    }
+
+    ElementPtr(std::nullptr_t) :
+      element_(nullptr)
+    {
+    }
+
+    ElementPtr(const ElementPtr& other) :
+      element_(other.element_)
+    {
+      if (element_) {
+        element_->ref();
+      }
+    }
+
+    ElementPtr(ElementPtr&& other) noexcept :
+      element_(other.element_)
+    {
+      other.element_ = nullptr;
+    }
+
+    ~ElementPtr() {
+      reset();
+    }
+
+    ElementPtr& operator=(const ElementPtr& other) {
+      ElementPtr copy(other);
+      std::swap(element_, copy.element_);
+      return *this;
+    }
+
+    ElementPtr& operator=(ElementPtr&& other) noexcept {
+      ElementPtr moved(std::move(other));
+      std::swap(element_, moved.element_);
+      return *this;
+    }
+
+    ElementPtr& operator=(std::nullptr_t) {
+      reset();
+      return *this;
+    }
+
+    /**
+     * @brief Drop this reference, releasing the element back into the pool if it was the last one
+     */
+    void reset() {
+      if (element_) {
+        Element* e = element_;
+        element_ = nullptr;
+        e->deref();
+      }
+    }
+
+    inline Element* get() const {
+      return element_;
+    }
+
+    inline Element* operator->() const {
+      return element_;
+    }
+
+    inline Element& operator*() const {
+      return *element_;
+    }
+
+    inline explicit operator bool() const {
+      return element_;
+    }
+
+    inline bool operator==(const ElementPtr& other) const {
+      return element_ == other.element_;
+    }
+
+    inline bool operator!=(const ElementPtr& other) const {
+      return element_ != other.element_;
+    }
+
+  private:
+    friend class Arena;
+
+    /**
+     * @brief Adopt an element whose reference count has already been set
+     */
+    explicit ElementPtr(Element* e) :
+      element_(e)
+    {
+    }
+
+    Element* element_;
+
+  };
 
   /**
    * @brief A memory pool arena - a subsection of memory
@@ -170,18 +308,28 @@ public:
    * The pool itself does not store memory, it stores "arenas". This is so that the pool can handle the situation of
    * an arena becoming full with no more memory to lend. A pool can automatically allocate another arena and continue
    * providing memory (and freeing arenas when they're no longer in use).
+   *
+   * Free elements are kept in a lock-free stack. The head of the stack is stored with a tag that changes on every
+   * push and pop so an element being popped and pushed back between another thread reading the head and swapping it
+   * can't go unnoticed.
    */
   class Arena {
   public:
     Arena(MemoryPool* parent) {
       parent_ = parent;
       data_ = nullptr;
-      use_count_ = 0;
+      elements_ = nullptr;
+      next_free_ = nullptr;
+      element_count_ = 0;
+      element_sz_ = 0;
+      empty_since_.store(Element::Now());
     }
 
     ~Arena() {
       // FIXME: Invalidate elements that have been lent out?
 
+      delete [] next_free_;
+      delete [] elements_;
       delete [] data_;
     }
 
@@ -191,41 +339,62 @@ public:
      * @brief Returns an element if there is free memory to do so
      */
     ElementPtr Get() {
-      QMutexLocker locker(&lock_);
-
-      for (int i=0;i<available_.size();i++) {
-        if (available_.at(i)) {
-          // This buffer is available
-          available_.replace(i, false);
-          use_count_++;
-          return std::make_shared<Element>(this, reinterpret_cast<T*>(data_ + i * element_sz_));
+      quint64 head = free_head_.load();
+      int index;
+
+      forever {
+        index = HeadIndex(head);
+
+        if (index == kNoElement) {
+          // Arena is full
+          return nullptr;
+        }
+
+        // If another thread takes this element first, the tag will have changed and we'll try again
+        quint64 new_head = MakeHead(next_free_[index].load(), HeadTag(head) + 1);
+
+        if (free_head_.testAndSetOrdered(head, new_head, head)) {
+          break;
         }
       }
 
-      return nullptr;
+      use_count_.ref();
+      parent_->ElementUsageChanged(1);
+
+      Element* e = &elements_[index];
+      e->ref_.store(1);
+      e->accessed_ = Element::Now();
+
+      return ElementPtr(e);
     }
 
     /**
      * @brief Releases an element back into the pool for use elsewhere
      */
     void Release(Element* e) {
-      QMutexLocker locker(&lock_);
-      quintptr diff = reinterpret_cast<quintptr>(e->data()) - reinterpret_cast<quintptr>(data_);
+      // Once the element is back in the stack, this arena may be destroyed by another thread as soon as the count
+      // reaches zero, so we take what we need from it beforehand
+      MemoryPool* parent = parent_;
 
-      int index = diff / element_sz_;
+      quint64 head = free_head_.load();
 
-      available_.replace(index, true);
-      use_count_--;
+      forever {
+        next_free_[e->index_].store(HeadIndex(head));
 
-      if (!use_count_) {
-        locker.unlock();
-        parent_->ArenaIsEmpty(this);
+        if (free_head_.testAndSetOrdered(head, MakeHead(e->index_, HeadTag(head) + 1), head)) {
+          break;
+        }
+      }
+
+      parent->ElementUsageChanged(-1);
+
+      if (!use_count_.deref()) {
+        parent->ArenaIsEmpty(this);
       }
     }
 
-    const int& GetUsageCount() {
-      QMutexLocker locker(&lock_);
-      return use_count_;
+    int GetUsageCount() const {
+      return use_count_.load();
     }
 
     bool Allocate(size_t ele_sz, size_t nb_elements) {
@@ -236,12 +405,24 @@ public:
       element_sz_ = ele_sz;
 
       if ((data_ = new char[element_sz_ * nb_elements])) {
-        available_.resize(nb_elements);
-        available_.fill(true);
+        element_count_ = static_cast<int>(nb_elements);
+
+        elements_ = new Element[nb_elements];
+        next_free_ = new QAtomicInt[nb_elements];
+
+        // Chain every element into the free stack in order
+        for (int i=0;i<element_count_;i++) {
+          elements_[i].parent_ = this;
+          elements_[i].data_ = reinterpret_cast<T*>(data_ + i * element_sz_);
+          elements_[i].index_ = i;
+
+          next_free_[i].store((i == element_count_ - 1) ? kNoElement : i + 1);
+        }
+
+        free_head_.store(MakeHead(0, 0));
 
         return true;
       } else {
-        available_.clear();
         data_ = nullptr;
 
         return false;
@@ -249,7 +430,18 @@ public:
     }
 
     inline int GetElementCount() const {
-      return available_.size();
+      return element_count_;
+    }
+
+    /**
+     * @brief The time this arena last became empty, only meaningful while GetUsageCount() is 0
+     */
+    inline int64_t GetEmptySince() const {
+      return empty_since_.load();
+    }
+
+    inline void SetEmptySince(int64_t t) {
+      empty_since_.store(t);
     }
 
     inline bool IsAllocated() const {
@@ -257,17 +449,37 @@ public:
     }
 
   private:
+    static const int kNoElement = -1;
+
+    static inline quint64 MakeHead(int index, quint32 tag) {
+      return (static_cast<quint64>(tag) << 32) | static_cast<quint32>(index);
+    }
+
+    static inline int HeadIndex(quint64 head) {
+      return static_cast<int>(static_cast<quint32>(head));
+    }
+
+    static inline quint32 HeadTag(quint64 head) {
+      return static_cast<quint32>(head >> 32);
+    }
+
     MemoryPool* parent_;
 
     char* data_;
 
-    QVector<bool> available_;
+    Element* elements_;
 
-    QMutex lock_;
+    QAtomicInt* next_free_;
 
-    size_t element_sz_;
+    QAtomicInteger<quint64> free_head_;
+
+    QAtomicInt use_count_;
+
+    QAtomicInteger<qint64> empty_since_;
+
+    int element_count_;
 
-    int use_count_;
+    size_t element_sz_;
 
   };
 
@@ -275,17 +487,25 @@ public:
    * @brief Retrieves an element from an available arena
    */
   ElementPtr Get() {
-    QMutexLocker locker(&lock_);
+    {
+      QReadLocker locker(&lock_);
 
-    // Attempt to get an element from an arena
-    foreach (Arena* a, arenas_) {
-      ElementPtr e = a->Get();
+      ElementPtr e = GetFromExistingArena();
 
       if (e) {
         return e;
       }
     }
 
+    QWriteLocker locker(&lock_);
+
+    // Another thread may have created an arena or released an element while we were waiting for the lock
+    ElementPtr e = GetFromExistingArena();
+
+    if (e) {
+      return e;
+    }
+
     // All arenas were empty, we'll need to create a new one
     if (arenas_.isEmpty()) {
       qDebug() << "No arenas, creating new...";
@@ -317,12 +537,36 @@ public:
   }
 
   void ArenaIsEmpty(Arena* a) {
-    QMutexLocker locker(&lock_);
+    QReadLocker locker(&lock_);
 
-    if (!a->GetUsageCount()) {
-      qDebug() << "Removing an empty arena";
-      arenas_.removeOne(a);
-      delete a;
+    // Empty arenas are kept around in case they're needed again soon and freed by ShrinkIdleArenas() instead. The
+    // arena may have already been freed if it emptied, filled, and emptied again in the meantime, in which case we
+    // mustn't touch it.
+    if (arenas_.contains(a)) {
+      a->SetEmptySince(Element::Now());
+    }
+  }
+
+  /**
+   * @brief Free arenas that have been empty for at least `idle_time` milliseconds
+   */
+  void ShrinkIdleArenas(int64_t idle_time) {
+    QWriteLocker locker(&lock_);
+
+    int64_t empty_before = Element::Now() - idle_time;
+
+    typename QLinkedList<Arena*>::iterator i = arenas_.begin();
+
+    while (i != arenas_.end()) {
+      Arena* a = *i;
+
+      if (!a->GetUsageCount() && a->GetEmptySince() <= empty_before) {
+        qDebug() << "Removing an idle arena";
+        i = arenas_.erase(i);
+        delete a;
+      } else {
+        i++;
+      }
     }
   }
 
@@ -336,12 +580,42 @@ protected:
     return sizeof(T);
   }
 
+  /**
+   * @brief Called whenever an element is lent out (delta = 1) or released back into the pool (delta = -1)
+   *
+   * May be called from any thread. Override to track memory usage, but make sure to call the base implementation too.
+   */
+  virtual void ElementUsageChanged(int delta) {
+    elements_in_use_.fetchAndAddRelaxed(delta);
+  }
+
 private:
+  /**
+   * @brief Try to get an element from the arenas we already have
+   *
+   * The arena list must be locked by the caller.
+   */
+  ElementPtr GetFromExistingArena() {
+    typename QLinkedList<Arena*>::const_iterator i;
+
+    for (i=arenas_.constBegin();i!=arenas_.constEnd();i++) {
+      ElementPtr e = (*i)->Get();
+
+      if (e) {
+        return e;
+      }
+    }
+
+    return nullptr;
+  }
+
   int element_count_;
 
+  QAtomicInt elements_in_use_;
+
   QLinkedList<Arena*> arenas_;
 
-  QMutex lock_;
+  QReadWriteLock lock_;
 
 };
 
@@ -59,39 +59,89 @@ void rational::fixSigns()
 
 void rational::reduce()
 {
-  // Euclidean often fails if numbers are negative, we abs it and re-neg it later if necessary
-  bool neg = numer < 0;
+  if(denom != 0 && numer != 0)
+    {
+      intType d = gcd(numer, denom);
 
-  numer = qAbs(numer);
+      if(d > 1)
+        {
+          numer /= d;
+          denom /= d;
+        }
+    }
+}
 
-  intType d = 1;
+//Function: finds greatest common denominator
 
-  if(denom != 0 && numer !=0)
-    d = gcd(numer, denom);
+intType rational::gcd(intType x, intType y)
+{
+  // Euclidean often fails if numbers are negative, so we only work with their magnitudes
+  x = qAbs(x);
+  y = qAbs(y);
 
-  if(d > 1)
+  while(y != 0)
     {
-      numer /= d;
-      denom /= d;
+      intType tmp = x % y;
+      x = y;
+      y = tmp;
     }
 
-  if (neg) {
-    numer = -numer;
-  }
+  return x;
 }
 
-//Function: finds greatest common denominator
+//Function: adds n/d to this value, both assumed to be in lowest form and non-zero
 
-intType rational::gcd(intType &x, intType &y)
+void rational::addFraction(const intType &n, const intType &d)
 {
-  if(y == 0)
-    return x;
+  // Knuth's method (TAOCP 4.5.1): working with the gcd of the denominators keeps the intermediates small, and since
+  // both values are already reduced, the sum can only share factors with that gcd. When the denominators are coprime
+  // (e.g. one of them is 1) the result needs no reduction at all, and when they're equal (stepping through a timebase)
+  // only the small second gcd is needed.
+  intType g = gcd(denom, d);
+
+  if(g == 1)
+    {
+      numer = (numer * d) + (n * denom);
+      denom = denom * d;
+    }
   else
     {
-      intType tmp = x % y;
+      intType t = (numer * (d / g)) + (n * (denom / g));
+      intType g2 = gcd(t, g);
 
-      return gcd(y, tmp);
+      numer = t / g2;
+      denom = (denom / g) * (d / g2);
     }
+
+  if(numer == intType(0))
+    denom = intType(0);
+}
+
+//Function: returns <0, 0, or >0 if this is less than, equal to, or greater than rhs
+
+int rational::compare(const rational &rhs) const
+{
+  // Both values are in lowest form with a positive denominator, so equal denominators only need their numerators
+  // compared. This also covers both values being zero.
+  if(denom == rhs.denom)
+    return (numer < rhs.numer) ? -1 : (numer > rhs.numer) ? 1 : 0;
+
+  // Zero is stored as 0/0, but for cross-multiplication it needs a denominator of 1
+  intType ld = (denom == intType(0)) ? intType(1) : denom;
+  intType rd = (rhs.denom == intType(0)) ? intType(1) : rhs.denom;
+
+#ifdef __SIZEOF_INT128__
+  // Cross-multiply in 128-bit so large timestamps can't overflow
+  __extension__ typedef __int128 int128;
+
+  int128 l = static_cast<int128>(numer) * rd;
+  int128 r = static_cast<int128>(rhs.numer) * ld;
+#else
+  intType l = numer * rd;
+  intType r = rhs.numer * ld;
+#endif
+
+  return (l < r) ? -1 : (l > r) ? 1 : 0;
 }
 
 //Function: convert to double
@@ -169,75 +219,66 @@ const rational& rational::operator=(const rational &rhs)
 
 const rational& rational::operator+=(const rational &rhs)
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
+  if(isNull())
     {
-      numer = intType(0);
-      denom = intType(0);
+      numer = rhs.numer;
+      denom = rhs.denom;
     }
   else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          numer = rhs.numer;
-          denom = rhs.denom;
-        }
-      else
-        {
-          numer = (numer * rhs.denom) + (rhs.numer * denom);
-          denom = denom * rhs.denom;
-          fixSigns();
-          reduce();
-        }
+    if(!rhs.isNull())
+      addFraction(rhs.numer, rhs.denom);
   return *this;
 }
 
 const rational& rational::operator-=(const rational &rhs)
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
+  if(isNull())
     {
-      numer = intType(0);
-      denom = intType(0);
+      numer = -(rhs.numer);
+      denom = rhs.denom;
     }
   else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          numer = -(rhs.numer);
-          denom = rhs.denom;
-        }
-      else
-        {
-          numer = (numer * rhs.denom) - (rhs.numer * denom);
-          denom = denom * rhs.denom;
-          fixSigns();
-          reduce();
-        }
+    if(!rhs.isNull())
+      addFraction(-rhs.numer, rhs.denom);
   return *this;
 }
 
 const rational& rational::operator/=(const rational &rhs)
 {
-  numer = numer * rhs.denom;
-  denom = denom * rhs.numer;
-  fixSigns();
-  reduce();
+  if(isNull() || rhs.isNull())
+    {
+      numer = intType(0);
+      denom = intType(0);
+    }
+  else
+    {
+      // Cancel common factors before multiplying so the result is already in lowest form
+      intType g1 = gcd(numer, rhs.numer);
+      intType g2 = gcd(denom, rhs.denom);
+
+      numer = (numer / g1) * (rhs.denom / g2);
+      denom = (denom / g2) * (rhs.numer / g1);
+      fixSigns();
+    }
   return *this;
 }
 
 const rational& rational::operator*=(const rational &rhs)
 {
-  numer = numer * rhs.numer;
-  denom = denom * rhs.denom;
-  fixSigns();
-  reduce();
+  if(isNull() || rhs.isNull())
+    {
+      numer = intType(0);
+      denom = intType(0);
+    }
+  else
+    {
+      // Cancel common factors before multiplying so the result is already in lowest form
+      intType g1 = gcd(numer, rhs.denom);
+      intType g2 = gcd(rhs.numer, denom);
+
+      numer = (numer / g1) * (rhs.numer / g2);
+      denom = (denom / g2) * (rhs.denom / g1);
+    }
   return *this;
 }
 
@@ -275,99 +316,22 @@ rational rational::operator*(const rational &rhs) const
 
 bool rational::operator<(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return false;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom < intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom < intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) < (denom * rhs.numer));
+  return compare(rhs) < 0;
 }
 
 bool rational::operator<=(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return true;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom < intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom < intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) <= (denom * rhs.numer));
+  return compare(rhs) <= 0;
 }
 
 bool rational::operator>(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return false;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom > intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom > intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) > (denom * rhs.numer));
+  return compare(rhs) > 0;
 }
 
 bool rational::operator>=(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return true;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom > intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom > intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-
-  return ((numer * rhs.denom) >= (denom * rhs.numer));
+  return compare(rhs) >= 0;
 }
 
 bool rational::operator==(const rational &rhs) const
@@ -405,7 +369,7 @@ const rational& rational::operator--()
 
 rational rational::operator--(int)
 {
-  rational tmp;
+  rational tmp = *this;
   numer -= denom;
   return tmp;
 }
@@ -115,7 +115,13 @@ private:
   //Function: ensures lowest form
   void reduce();
   //Function: finds greatest common denominator
-  intType gcd(intType &x, intType &y);
+  static intType gcd(intType x, intType y);
+
+  //Function: adds n/d to this value, both assumed to be in lowest form and non-zero
+  void addFraction(const intType& n, const intType& d);
+
+  //Function: returns <0, 0, or >0 if this is less than, equal to, or greater than rhs
+  int compare(const rational& rhs) const;
 };
 
 // We define these limits at 32-bit to try avoiding integer overflow
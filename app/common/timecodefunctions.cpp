@@ -258,7 +258,23 @@ bool Timecode::TimebaseIsDropFrame(const rational &timebase)
 
 int64_t Timecode::time_to_timestamp(const rational &time, const rational &timebase)
 {
-  return time_to_timestamp(time.toDouble(), timebase);
+  // Stay in integers so frame-aligned times always land exactly on their timestamp
+  rational ticks = time / timebase;
+
+  if (ticks.isNull()) {
+    return 0;
+  }
+
+  // Round half up, matching qRound64()
+  int64_t n = 2 * ticks.numerator() + ticks.denominator();
+  int64_t d = 2 * ticks.denominator();
+  int64_t ts = n / d;
+
+  if (n % d < 0) {
+    ts--;
+  }
+
+  return ts;
 }
 
 int64_t Timecode::time_to_timestamp(const double &time, const rational &timebase)
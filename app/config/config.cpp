@@ -31,6 +31,7 @@
 #include "common/filefunctions.h"
 #include "common/xmlutils.h"
 #include "core.h"
+#include "render/backend/videorenderframecache.h"
 #include "window/mainwindow/mainwindow.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -88,9 +89,13 @@ void Config::SetDefaults()
 
   config_map_["DiskCachePath"] = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
   config_map_["DiskCacheSize"] = 20.0;
+  config_map_["MemoryCacheSize"] = 1.0;
+  config_map_["DecoderMemorySize"] = 2.0;
+  config_map_["DiskCacheFormat"] = VideoRenderFrameCache::kCacheFormatCompressed;
   config_map_["DiskCacheBehind"] = QVariant::fromValue(rational(2));
   config_map_["DiskCacheAhead"] = QVariant::fromValue(rational(10));
   config_map_["ClearDiskCacheOnClose"] = false;
+  config_map_["GenerateProxies"] = false;
 
   config_map_["DefaultSequenceWidth"] = 1920;
   config_map_["DefaultSequenceHeight"] = 1080;
@@ -32,6 +32,7 @@
 
 #include "audio/audiomanager.h"
 #include "cli/clitask/clitaskdialog.h"
+#include "codec/ffmpeg/ffmpegframepool.h"
 #include "common/filefunctions.h"
 #include "common/xmlutils.h"
 #include "config/config.h"
@@ -49,8 +50,10 @@
 #include "project/projectloadmanager.h"
 #include "project/projectsavemanager.h"
 #include "render/backend/indexmanager.h"
+#include "render/backend/videorenderframecache.h"
 #include "render/backend/opengl/opengltexturecache.h"
 #include "render/colormanager.h"
+#include "render/diskcachewriter.h"
 #include "render/diskmanager.h"
 #include "render/pixelformat.h"
 #include "task/taskmanager.h"
@@ -127,6 +130,7 @@ bool Core::Start()
 
   // Initialize disk service
   DiskManager::CreateInstance();
+  DiskCacheWriter::CreateInstance();
 
   // Initialize task manager
   TaskManager::CreateInstance();
@@ -138,6 +142,10 @@ bool Core::Start()
   // Load application config
   Config::Load();
 
+  // Cache config values read from other threads
+  FFmpegFramePool::UpdateMemoryLimit();
+  VideoRenderFrameCache::UpdateCacheFormat();
+
 
   //
   // Start application
@@ -220,6 +228,8 @@ void Core::Stop()
 
   AudioManager::DestroyInstance();
 
+  DiskCacheWriter::DestroyInstance();
+
   DiskManager::DestroyInstance();
 
   PixelFormat::DestroyInstance();
@@ -532,6 +542,7 @@ void Core::DeclareTypesForQt()
   qRegisterMetaType<NodeValueTable>();
   qRegisterMetaType<NodeValueDatabase>();
   qRegisterMetaType<FramePtr>();
+  qRegisterMetaType<YUVFramePtr>();
   qRegisterMetaType<SampleBufferPtr>();
   qRegisterMetaType<AudioRenderingParams>();
   qRegisterMetaType<NodeKeyframe::Type>();
@@ -27,6 +27,8 @@
 #include <QLabel>
 #include <QMessageBox>
 
+#include "codec/ffmpeg/ffmpegframepool.h"
+#include "render/backend/videorenderframecache.h"
 #include "render/diskmanager.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -65,6 +67,36 @@ PreferencesDiskTab::PreferencesDiskTab()
 
   row++;
 
+  disk_management_layout->addWidget(new QLabel(tr("Maximum Memory Cache:")), row, 0);
+
+  maximum_memory_cache_slider_ = new FloatSlider();
+  maximum_memory_cache_slider_->SetFormat(tr("%1 GB"));
+  maximum_memory_cache_slider_->SetMinimum(0.0);
+  maximum_memory_cache_slider_->SetValue(Config::Current()["MemoryCacheSize"].toDouble());
+  disk_management_layout->addWidget(maximum_memory_cache_slider_, row, 1, 1, 2);
+
+  row++;
+
+  disk_management_layout->addWidget(new QLabel(tr("Maximum Decoder Memory:")), row, 0);
+
+  maximum_decoder_memory_slider_ = new FloatSlider();
+  maximum_decoder_memory_slider_->SetFormat(tr("%1 GB"));
+  maximum_decoder_memory_slider_->SetMinimum(0.0);
+  maximum_decoder_memory_slider_->SetValue(Config::Current()["DecoderMemorySize"].toDouble());
+  disk_management_layout->addWidget(maximum_decoder_memory_slider_, row, 1, 1, 2);
+
+  row++;
+
+  disk_management_layout->addWidget(new QLabel(tr("Disk Cache Format:")), row, 0);
+
+  cache_format_ = new QComboBox();
+  cache_format_->addItem(tr("Compressed (Smaller)"), VideoRenderFrameCache::kCacheFormatCompressed);
+  cache_format_->addItem(tr("Uncompressed (Faster, Lossless)"), VideoRenderFrameCache::kCacheFormatRaw);
+  cache_format_->setCurrentIndex(cache_format_->findData(Config::Current()["DiskCacheFormat"].toInt()));
+  disk_management_layout->addWidget(cache_format_, row, 1, 1, 2);
+
+  row++;
+
   clear_cache_btn_ = new QPushButton(tr("Clear Disk Cache"));
   connect(clear_cache_btn_, &QPushButton::clicked, this, &PreferencesDiskTab::ClearDiskCache);
   disk_management_layout->addWidget(clear_cache_btn_, row, 1, 1, 2);
@@ -75,6 +107,13 @@ PreferencesDiskTab::PreferencesDiskTab()
   clear_disk_cache_->setChecked(Config::Current()["ClearDiskCacheOnClose"].toBool());
   disk_management_layout->addWidget(clear_disk_cache_, row, 1, 1, 2);
 
+  row++;
+
+  generate_proxies_ = new QCheckBox(tr("Generate proxies for video larger than 1080p"));
+  generate_proxies_->setToolTip(tr("Proxies are stored with the disk cache and count towards its maximum size."));
+  generate_proxies_->setChecked(Config::Current()["GenerateProxies"].toBool());
+  disk_management_layout->addWidget(generate_proxies_, row, 1, 1, 2);
+
   QGroupBox* cache_behavior = new QGroupBox(tr("Cache Behavior"));
   outer_layout->addWidget(cache_behavior);
   QGridLayout* cache_behavior_layout = new QGridLayout(cache_behavior);
@@ -102,7 +141,13 @@ void PreferencesDiskTab::Accept()
 {
   Config::Current()["DiskCachePath"] = disk_cache_location_->text();
   Config::Current()["DiskCacheSize"] = maximum_cache_slider_->GetValue();
+  Config::Current()["MemoryCacheSize"] = maximum_memory_cache_slider_->GetValue();
+  Config::Current()["DecoderMemorySize"] = maximum_decoder_memory_slider_->GetValue();
+  FFmpegFramePool::UpdateMemoryLimit();
+  Config::Current()["DiskCacheFormat"] = cache_format_->currentData();
+  VideoRenderFrameCache::UpdateCacheFormat();
   Config::Current()["ClearDiskCacheOnClose"] = clear_disk_cache_->isChecked();
+  Config::Current()["GenerateProxies"] = generate_proxies_->isChecked();
   Config::Current()["DiskCacheBehind"] = QVariant::fromValue(rational::fromDouble(cache_behind_slider_->GetValue()));
   Config::Current()["DiskCacheAhead"] = QVariant::fromValue(rational::fromDouble(cache_ahead_slider_->GetValue()));
 }
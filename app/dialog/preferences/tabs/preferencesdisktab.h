@@ -22,6 +22,7 @@
 #define PREFERENCESDISKTAB_H
 
 #include <QCheckBox>
+#include <QComboBox>
 #include <QLineEdit>
 #include <QPushButton>
 
@@ -43,12 +44,20 @@ private:
 
   FloatSlider* maximum_cache_slider_;
 
+  FloatSlider* maximum_memory_cache_slider_;
+
+  FloatSlider* maximum_decoder_memory_slider_;
+
+  QComboBox* cache_format_;
+
   FloatSlider* cache_ahead_slider_;
 
   FloatSlider* cache_behind_slider_;
 
   QCheckBox* clear_disk_cache_;
 
+  QCheckBox* generate_proxies_;
+
   QPushButton* clear_cache_btn_;
 
 private slots:
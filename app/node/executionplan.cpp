@@ -0,0 +1,82 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+
+#include "executionplan.h"
+
+#include "node.h"
+
+OLIVE_NAMESPACE_ENTER
+
+void NodeExecutionPlan::Compile(const QList<Node*> &nodes)
+{
+  Clear();
+
+  steps_.resize(nodes.size());
+
+  for (int i=0;i<nodes.size();i++) {
+    steps_[i].node = nodes.at(i);
+    step_index_.insert(nodes.at(i), i);
+  }
+
+  // Resolve inputs once every node has an index
+  for (int i=0;i<steps_.size();i++) {
+    Step& step = steps_[i];
+
+    foreach (NodeParam* param, step.node->parameters()) {
+      if (param->type() == NodeParam::kInput) {
+        InputSlot slot;
+
+        slot.input = static_cast<NodeInput*>(param);
+        slot.source = slot.input->IsConnected() ? IndexOf(slot.input->get_connected_node()) : -1;
+
+        step.inputs.append(slot);
+      }
+    }
+  }
+}
+
+void NodeExecutionPlan::Clear()
+{
+  steps_.clear();
+  step_index_.clear();
+}
+
+bool NodeExecutionPlan::isEmpty() const
+{
+  return steps_.isEmpty();
+}
+
+int NodeExecutionPlan::size() const
+{
+  return steps_.size();
+}
+
+const NodeExecutionPlan::Step &NodeExecutionPlan::at(int index) const
+{
+  return steps_.at(index);
+}
+
+int NodeExecutionPlan::IndexOf(const Node *node) const
+{
+  return step_index_.value(node, -1);
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,83 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+
+#ifndef NODEEXECUTIONPLAN_H
+#define NODEEXECUTIONPLAN_H
+
+#include <QHash>
+#include <QVector>
+
+#include "input.h"
+
+OLIVE_NAMESPACE_ENTER
+
+class Node;
+
+/**
+ * @brief A node graph resolved into a flat array of steps
+ *
+ * Each step holds one node's inputs along with the index of the step connected to each of them, so a traverser can
+ * follow the graph by indexing into arrays rather than walking parameter lists and edges for every frame. A plan is
+ * only valid for as long as the connections in the graph it was compiled from don't change.
+ */
+class NodeExecutionPlan
+{
+public:
+  struct InputSlot {
+    NodeInput* input;
+
+    /// Index of the step connected to this input, or -1 if it isn't connected
+    int source;
+  };
+
+  struct Step {
+    const Node* node;
+
+    QVector<InputSlot> inputs;
+  };
+
+  NodeExecutionPlan() = default;
+
+  void Compile(const QList<Node*>& nodes);
+
+  void Clear();
+
+  bool isEmpty() const;
+
+  int size() const;
+
+  const Step& at(int index) const;
+
+  /**
+   * @brief Returns the index of the step for this node, or -1 if it isn't part of the plan
+   */
+  int IndexOf(const Node* node) const;
+
+private:
+  QVector<Step> steps_;
+
+  QHash<const Node*, int> step_index_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // NODEEXECUTIONPLAN_H
@@ -436,79 +436,73 @@ QVariant NodeInput::get_value_at_time_for_track(const rational& time, int track)
       return key_track.last()->value();
     }
 
-    // If we're here, the time must be somewhere in between the keyframes
-    for (int i=0;i<key_track.size()-1;i++) {
-      NodeKeyframePtr before = key_track.at(i);
-      NodeKeyframePtr after = key_track.at(i+1);
+    // If we're here, the time must be somewhere in between the keyframes. Tracks can be very long (e.g. tracking
+    // data) so we binary search for the pair rather than scanning from the start.
+    int before_index = GetKeyframeIndexAtOrBefore(key_track, time);
 
-      if (before->time() == time
-          || !type_can_be_interpolated(data_type())
-          || (before->time() < time && before->type() == NodeKeyframe::kHold)) {
+    const NodeKeyframePtr& before = key_track.at(before_index);
+    const NodeKeyframePtr& after = key_track.at(before_index + 1);
 
-        // Time == keyframe time, so value is precise
-        return before->value();
+    if (before->time() == time
+        || !type_can_be_interpolated(data_type())
+        || before->type() == NodeKeyframe::kHold) {
 
-      } else if (after->time() == time) {
+      // Time == keyframe time, so value is precise
+      return before->value();
 
-        // Time == keyframe time, so value is precise
-        return after->value();
-
-      } else if (before->time() < time && after->time() > time) {
-        // We must interpolate between these keyframes
-
-        if (before->type() == NodeKeyframe::kBezier && after->type() == NodeKeyframe::kBezier) {
-          // Perform a cubic bezier with two control points
-
-          double t = Bezier::CubicXtoT(time.toDouble(),
-                                       before->time().toDouble(),
-                                       before->time().toDouble() + before->bezier_control_out().x(),
-                                       after->time().toDouble() + after->bezier_control_in().x(),
-                                       after->time().toDouble());
+    }
 
-          double y = Bezier::CubicTtoY(before->value().toDouble(),
-                                       before->value().toDouble() + before->bezier_control_out().y(),
-                                       after->value().toDouble() + after->bezier_control_in().y(),
-                                       after->value().toDouble(),
-                                       t);
+    // We must interpolate between these keyframes
+    return InterpolateKeyframes(before, after, time.toDouble());
+  }
 
-          return y;
+  return standard_value_.at(track);
+}
 
-        } else if (before->type() == NodeKeyframe::kBezier || after->type() == NodeKeyframe::kBezier) {
-          // Perform a quadratic bezier with only one control point
+QVector<double> NodeInput::get_values_at_times_for_track(const QVector<rational> &times, int track) const
+{
+  QVector<double> values(times.size());
 
-          QPointF control_point;
-          double control_point_time;
-          double control_point_value;
+  if (is_using_standard_value(track)) {
+    values.fill(standard_value_.at(track).toDouble());
+    return values;
+  }
 
-          if (before->type() == NodeKeyframe::kBezier) {
-            control_point = before->bezier_control_out();
-            control_point_time = before->time().toDouble() + control_point.x();
-            control_point_value = before->value().toDouble() + control_point.y();
-          } else {
-            control_point = after->bezier_control_in();
-            control_point_time = after->time().toDouble() + control_point.x();
-            control_point_value = after->value().toDouble() + control_point.y();
-          }
+  const KeyframeTrack& key_track = keyframe_tracks_.at(track);
+  bool can_interpolate = type_can_be_interpolated(data_type());
+  int before_index = -1;
 
-          // Generate T from time values - used to determine bezier progress
-          double t = Bezier::QuadraticXtoT(time.toDouble(), before->time().toDouble(), control_point_time, after->time().toDouble());
+  for (int i=0;i<times.size();i++) {
+    const rational& time = times.at(i);
 
-          // Generate value using T
-          double y = Bezier::QuadraticTtoY(before->value().toDouble(), control_point_value, after->value().toDouble(), t);
+    if (i == 0 || (before_index >= 0 && time < key_track.at(before_index)->time())) {
+      // First time, or times went backwards, so search for where to start walking from
+      before_index = GetKeyframeIndexAtOrBefore(key_track, time);
+    }
 
-          return y;
+    // Walk forward through any keyframes we've passed since the last time
+    while (before_index + 1 < key_track.size() && key_track.at(before_index + 1)->time() <= time) {
+      before_index++;
+    }
 
-        } else {
-          // To have arrived here, the keyframes must both be linear
-          qreal period_progress = (time.toDouble() - before->time().toDouble()) / (after->time().toDouble() - before->time().toDouble());
+    if (before_index < 0) {
+      // This time precedes any keyframe, so we just return the first value
+      values[i] = key_track.first()->value().toDouble();
+    } else {
+      const NodeKeyframePtr& before = key_track.at(before_index);
 
-          return lerp(before->value().toDouble(), after->value().toDouble(), period_progress);
-        }
+      if (before_index == key_track.size() - 1
+          || before->time() == time
+          || !can_interpolate
+          || before->type() == NodeKeyframe::kHold) {
+        values[i] = before->value().toDouble();
+      } else {
+        values[i] = InterpolateKeyframes(before, key_track.at(before_index + 1), time.toDouble());
       }
     }
   }
 
-  return standard_value_.at(track);
+  return values;
 }
 
 QList<NodeKeyframePtr> NodeInput::get_keyframe_at_time(const rational &time) const
@@ -529,10 +523,12 @@ QList<NodeKeyframePtr> NodeInput::get_keyframe_at_time(const rational &time) con
 NodeKeyframePtr NodeInput::get_keyframe_at_time_on_track(const rational &time, int track) const
 {
   if (!is_using_standard_value(track)) {
-    foreach (NodeKeyframePtr key, keyframe_tracks_.at(track)) {
-      if (key->time() == time) {
-        return key;
-      }
+    const KeyframeTrack& key_track = keyframe_tracks_.at(track);
+
+    int index = GetKeyframeIndexAtOrBefore(key_track, time);
+
+    if (index >= 0 && key_track.at(index)->time() == time) {
+      return key_track.at(index);
     }
   }
 
@@ -775,6 +771,76 @@ void NodeInput::KeyframeBezierOutChanged()
   emit ValueChanged(start, end);
 }
 
+double NodeInput::InterpolateKeyframes(const NodeKeyframePtr &before, const NodeKeyframePtr &after, double x)
+{
+  double before_time = before->time().toDouble();
+  double before_value = before->value().toDouble();
+  double after_time = after->time().toDouble();
+  double after_value = after->value().toDouble();
+
+  if (before->type() == NodeKeyframe::kBezier && after->type() == NodeKeyframe::kBezier) {
+    // Perform a cubic bezier with two control points
+
+    double t = Bezier::CubicXtoT(x,
+                                 before_time,
+                                 before_time + before->bezier_control_out().x(),
+                                 after_time + after->bezier_control_in().x(),
+                                 after_time);
+
+    double y = Bezier::CubicTtoY(before_value,
+                                 before_value + before->bezier_control_out().y(),
+                                 after_value + after->bezier_control_in().y(),
+                                 after_value,
+                                 t);
+
+    return y;
+
+  } else if (before->type() == NodeKeyframe::kBezier || after->type() == NodeKeyframe::kBezier) {
+    // Perform a quadratic bezier with only one control point
+
+    QPointF control_point;
+    double control_point_time;
+    double control_point_value;
+
+    if (before->type() == NodeKeyframe::kBezier) {
+      control_point = before->bezier_control_out();
+      control_point_time = before_time + control_point.x();
+      control_point_value = before_value + control_point.y();
+    } else {
+      control_point = after->bezier_control_in();
+      control_point_time = after_time + control_point.x();
+      control_point_value = after_value + control_point.y();
+    }
+
+    // Generate T from time values - used to determine bezier progress
+    double t = Bezier::QuadraticXtoT(x, before_time, control_point_time, after_time);
+
+    // Generate value using T
+    double y = Bezier::QuadraticTtoY(before_value, control_point_value, after_value, t);
+
+    return y;
+
+  } else {
+    // To have arrived here, the keyframes must both be linear
+    qreal period_progress = (x - before_time) / (after_time - before_time);
+
+    return lerp(before_value, after_value, period_progress);
+  }
+}
+
+int NodeInput::GetKeyframeIndexAtOrBefore(const KeyframeTrack &track, const rational &time)
+{
+  // Tracks are always kept sorted by insert_keyframe_internal()
+  KeyframeTrack::const_iterator it = std::upper_bound(track.cbegin(),
+                                                      track.cend(),
+                                                      time,
+                                                      [](const rational& t, const NodeKeyframePtr& key) {
+    return t < key->time();
+  });
+
+  return static_cast<int>(it - track.cbegin()) - 1;
+}
+
 int NodeInput::FindIndexOfKeyframeFromRawPtr(NodeKeyframe *raw_ptr) const
 {
   const KeyframeTrack& track = keyframe_tracks_.at(raw_ptr->track());
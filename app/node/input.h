@@ -105,6 +105,17 @@ public:
    */
   QVariant get_value_at_time_for_track(const rational& time, int track) const;
 
+  /**
+   * @brief Calculate the stored value for a specific track at each of a list of times
+   *
+   * Rather than searching the keyframes for each time, this walks through them alongside the times, so sampling a whole
+   * range (e.g. every sample of an audio buffer) only costs one pass. Times should be in ascending order for this to be
+   * fast, though any order will produce correct values.
+   *
+   * Values are converted to double so this is only useful for numeric data types.
+   */
+  QVector<double> get_values_at_times_for_track(const QVector<rational>& times, int track) const;
+
   /**
    * @brief Retrieve a list of keyframe objects for all tracks at a given time
    *
@@ -308,6 +319,18 @@ private:
    */
   int FindIndexOfKeyframeFromRawPtr(NodeKeyframe* raw_ptr) const;
 
+  /**
+   * @brief Binary searches a track for the last keyframe at or before a time
+   *
+   * Returns -1 if every keyframe is after the time.
+   */
+  static int GetKeyframeIndexAtOrBefore(const KeyframeTrack& track, const rational& time);
+
+  /**
+   * @brief Interpolates between two neighboring keyframes at `x` seconds
+   */
+  static double InterpolateKeyframes(const NodeKeyframePtr& before, const NodeKeyframePtr& after, double x);
+
   /**
    * @brief Internal insert function, automatically does an insertion sort based on the keyframe's time
    */
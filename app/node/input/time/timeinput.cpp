@@ -51,6 +51,11 @@ QString TimeInput::Description() const
   return tr("Generates the time (in seconds) at this frame");
 }
 
+bool TimeInput::OutputDependsOnTime() const
+{
+  return true;
+}
+
 NodeValueTable TimeInput::Value(NodeValueDatabase &value) const
 {
   NodeValueTable table = value.Merge();
@@ -38,6 +38,8 @@ public:
   virtual QString Category() const override;
   virtual QString Description() const override;
 
+  virtual bool OutputDependsOnTime() const override;
+
   virtual NodeValueTable Value(NodeValueDatabase& value) const override;
 
 };
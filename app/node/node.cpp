@@ -371,6 +371,11 @@ bool Node::IsTrack() const
   return false;
 }
 
+bool Node::OutputDependsOnTime() const
+{
+  return false;
+}
+
 const QList<NodeParam *>& Node::parameters() const
 {
   return params_;
@@ -319,6 +319,14 @@ public:
    */
   virtual bool IsTrack() const;
 
+  /**
+   * @brief Returns whether this Node's output changes over time even when its inputs don't
+   *
+   * This is true for nodes that read the "global" time values in Value(). Renderers use it to determine whether a
+   * node's hash can be reused across frames.
+   */
+  virtual bool OutputDependsOnTime() const;
+
   /**
    * @brief The main processing function
    *
@@ -24,6 +24,15 @@
 
 OLIVE_NAMESPACE_ENTER
 
+NodeTraverser::NodeTraverser() :
+  plan_(nullptr),
+  traversal_depth_(0),
+  value_cache_hits_(0),
+  value_cache_misses_(0),
+  value_cache_suspended_(0)
+{
+}
+
 NodeValueDatabase NodeTraverser::GenerateDatabase(const Node* node, const TimeRange &range)
 {
   NodeValueDatabase database;
@@ -46,33 +55,122 @@ NodeValueDatabase NodeTraverser::GenerateDatabase(const Node* node, const TimeRa
     }
   }
 
-  // Insert global variables
+  InsertGlobals(&database, range);
+
+  return database;
+}
+
+NodeValueDatabase NodeTraverser::GenerateDatabaseFromPlan(int step_index, const TimeRange &range)
+{
+  const NodeExecutionPlan::Step& step = plan_->at(step_index);
+
+  NodeValueDatabase database;
+
+  foreach (const NodeExecutionPlan::InputSlot& slot, step.inputs) {
+    if (IsCancelled()) {
+      return NodeValueDatabase();
+    }
+
+    TimeRange input_time = step.node->InputTimeAdjustment(slot.input, range);
+
+    NodeValueTable table;
+
+    if (slot.source >= 0) {
+      // Follow the pre-resolved connection straight to its step
+      table = ProcessNodeInternal(plan_->at(slot.source).node, slot.source, input_time);
+    } else {
+      table = ProcessInput(slot.input, input_time);
+    }
+
+    InputProcessingEvent(slot.input, input_time, &table);
+
+    database.Insert(slot.input, table);
+  }
+
+  InsertGlobals(&database, range);
+
+  return database;
+}
+
+void NodeTraverser::InsertGlobals(NodeValueDatabase *database, const TimeRange &range)
+{
   NodeValueTable global;
   global.Push(NodeParam::kFloat, range.in().toDouble(), QStringLiteral("time_in"));
   global.Push(NodeParam::kFloat, range.out().toDouble(), QStringLiteral("time_out"));
-  database.Insert(QStringLiteral("global"), global);
-
-  return database;
+  database->Insert(QStringLiteral("global"), global);
 }
 
 NodeValueTable NodeTraverser::ProcessNode(const NodeDependency& dep)
 {
-  const Node* node = dep.node();
+  if (!traversal_depth_) {
+    // This is a new traversal so anything cached by the last one may be out of date
+    value_cache_.clear();
+    value_cache_hits_ = 0;
+    value_cache_misses_ = 0;
+  }
 
+  traversal_depth_++;
+
+  // Only the node we start from needs looking up in the plan, every step after that is reached by index
+  int step = plan_ ? plan_->IndexOf(dep.node()) : -1;
+
+  NodeValueTable table = ProcessNodeInternal(dep.node(), step, dep.range());
+
+  traversal_depth_--;
+
+  return table;
+}
+
+void NodeTraverser::SetExecutionPlan(const NodeExecutionPlan *plan)
+{
+  plan_ = plan;
+}
+
+int NodeTraverser::value_cache_hits() const
+{
+  return value_cache_hits_;
+}
+
+int NodeTraverser::value_cache_misses() const
+{
+  return value_cache_misses_;
+}
+
+NodeValueTable NodeTraverser::ProcessNodeInternal(const Node *node, int step, const TimeRange &range)
+{
   if (node->IsTrack()) {
     // If the range is not wholly contained in this Block, we'll need to do some extra processing
-    return RenderBlock(static_cast<const TrackOutput*>(node), dep.range());
+    return RenderBlock(static_cast<const TrackOutput*>(node), range);
   }
 
-  // FIXME: Cache certain values here if we've already processed them before
+  // If another input already needed this node at this time, reuse its value rather than processing it (and everything
+  // it depends on) again
+  ValueCacheKey cache_key(node, range);
+
+  bool use_cache = !value_cache_suspended_;
+
+  if (use_cache) {
+    QHash<ValueCacheKey, NodeValueTable>::const_iterator cached = value_cache_.constFind(cache_key);
+    if (cached != value_cache_.constEnd()) {
+      value_cache_hits_++;
+      return cached.value();
+    }
+
+    value_cache_misses_++;
+  }
 
   // Generate database of input values of node
-  NodeValueDatabase database = GenerateDatabase(node, dep.range());
+  NodeValueDatabase database = (step >= 0) ? GenerateDatabaseFromPlan(step, range) : GenerateDatabase(node, range);
 
   // By this point, the node should have all the inputs it needs to render correctly
   NodeValueTable table = node->Value(database);
 
-  ProcessNodeEvent(node, dep.range(), database, table);
+  ProcessNodeEvent(node, range, database, table);
+
+  // A cancelled traversal may have produced an incomplete value so we don't keep it
+  if (use_cache && !IsCancelled()) {
+    value_cache_.insert(cache_key, table);
+  }
 
   return table;
 }
@@ -83,11 +181,21 @@ NodeValueTable NodeTraverser::RenderBlock(const TrackOutput *track, const TimeRa
   return NodeValueTable();
 }
 
-NodeValueTable NodeTraverser::ProcessInput(const NodeInput *input, const TimeRange& range)
+NodeValueTable NodeTraverser::ProcessInput(const NodeInput *input, const TimeRange& range, bool cache_values)
 {
   if (input->IsConnected()) {
+    if (!cache_values) {
+      value_cache_suspended_++;
+    }
+
     // Value will equal something from the connected node, follow it
-    return ProcessNode(NodeDependency(input->get_connected_node(), range));
+    NodeValueTable table = ProcessNode(NodeDependency(input->get_connected_node(), range));
+
+    if (!cache_values) {
+      value_cache_suspended_--;
+    }
+
+    return table;
   } else {
     // Push onto the table the value at this time from the input
     QVariant input_value = input->get_value_at_time(range.in());
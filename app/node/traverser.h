@@ -24,6 +24,7 @@
 #include "codec/decoder.h"
 #include "common/cancelableobject.h"
 #include "dependency.h"
+#include "executionplan.h"
 #include "node/output/track/track.h"
 #include "project/item/footage/stream.h"
 #include "value.h"
@@ -33,21 +34,72 @@ OLIVE_NAMESPACE_ENTER
 class NodeTraverser : public CancelableObject
 {
 public:
-  NodeTraverser() = default;
-
+  NodeTraverser();
+
+  /**
+   * @brief Process a node and everything it depends on
+   *
+   * Within one traversal (i.e. until the outermost ProcessNode() call returns), each node is only processed once per
+   * time range. Any other input that depends on the same node at the same time reuses the first result.
+   */
   NodeValueTable ProcessNode(const NodeDependency &dep);
 
+  /**
+   * @brief Traverse using a plan compiled from the graph rather than querying each node's inputs and connections
+   *
+   * The plan must outlive any traversal using it. Nodes that aren't part of the plan are traversed normally.
+   */
+  void SetExecutionPlan(const NodeExecutionPlan* plan);
+
+  /**
+   * @brief Number of times a node's value was reused during the last traversal
+   */
+  int value_cache_hits() const;
+
+  /**
+   * @brief Number of times a node had to be processed during the last traversal
+   */
+  int value_cache_misses() const;
+
 protected:
   NodeValueDatabase GenerateDatabase(const Node *node, const TimeRange &range);
 
   virtual NodeValueTable RenderBlock(const TrackOutput *track, const TimeRange& range);
 
-  NodeValueTable ProcessInput(const NodeInput* input, const TimeRange &range);
+  /**
+   * @brief Get the value of an input at this time
+   *
+   * If `cache_values` is false, nothing traversed for this input is stored for reuse. This is for values that are
+   * fetched many times at times that will never be asked for again, like one audio sample at a time.
+   */
+  NodeValueTable ProcessInput(const NodeInput* input, const TimeRange &range, bool cache_values = true);
 
   virtual void InputProcessingEvent(NodeInput*, const TimeRange&, NodeValueTable*){}
 
   virtual void ProcessNodeEvent(const Node*, const TimeRange&, NodeValueDatabase&, NodeValueTable&){}
 
+private:
+  NodeValueTable ProcessNodeInternal(const Node* node, int step, const TimeRange& range);
+
+  NodeValueDatabase GenerateDatabaseFromPlan(int step_index, const TimeRange& range);
+
+  static void InsertGlobals(NodeValueDatabase* database, const TimeRange& range);
+
+  const NodeExecutionPlan* plan_;
+
+  using ValueCacheKey = QPair<const Node*, TimeRange>;
+
+  QHash<ValueCacheKey, NodeValueTable> value_cache_;
+
+  int traversal_depth_;
+
+  int value_cache_hits_;
+
+  int value_cache_misses_;
+
+  // Above zero while traversing values that shouldn't be cached
+  int value_cache_suspended_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
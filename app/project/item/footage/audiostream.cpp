@@ -133,4 +133,18 @@ void AudioStream::append_conformed_version(const AudioRenderingParams &params)
   emit ConformAppended(params);
 }
 
+QString AudioStream::waveform_filename()
+{
+  QMutexLocker locker(&index_access_lock_);
+
+  return waveform_filename_;
+}
+
+void AudioStream::set_waveform_filename(const QString &filename)
+{
+  QMutexLocker locker(&index_access_lock_);
+
+  waveform_filename_ = filename;
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -60,6 +60,12 @@ public:
   bool has_conformed_version(const AudioRenderingParams& params);
   void append_conformed_version(const AudioRenderingParams& params);
 
+  /**
+   * @brief Filename of this stream's WaveformPyramid, or an empty string if it hasn't been generated yet
+   */
+  QString waveform_filename();
+  void set_waveform_filename(const QString& filename);
+
 signals:
   void ConformAppended(const AudioRenderingParams& params);
 
@@ -74,6 +80,8 @@ private:
 
   QVector<AudioRenderingParams> conformed_;
 
+  QString waveform_filename_;
+
 };
 
 using AudioStreamPtr = std::shared_ptr<AudioStream>;
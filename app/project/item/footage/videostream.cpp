@@ -23,6 +23,7 @@
 #include <QFile>
 
 #include "common/timecodefunctions.h"
+#include "footage.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -30,7 +31,8 @@ const int64_t VideoStream::kEndTimestamp = AV_NOPTS_VALUE;
 
 VideoStream::VideoStream() :
   start_time_(0),
-  is_image_sequence_(false)
+  is_image_sequence_(false),
+  proxy_divider_(0)
 {
   set_type(kVideo);
 }
@@ -205,4 +207,40 @@ bool VideoStream::save_frame_index(const QString &s)
   return false;
 }
 
+void VideoStream::set_proxy(std::shared_ptr<Footage> footage, int divider)
+{
+  std::shared_ptr<VideoStream> proxy_stream;
+
+  foreach (StreamPtr s, footage->streams()) {
+    if (s->type() == kVideo) {
+      proxy_stream = std::static_pointer_cast<VideoStream>(s);
+      break;
+    }
+  }
+
+  if (!proxy_stream) {
+    return;
+  }
+
+  QMutexLocker locker(&index_access_lock_);
+
+  proxy_footage_ = footage;
+  proxy_ = proxy_stream;
+  proxy_divider_ = divider;
+}
+
+std::shared_ptr<VideoStream> VideoStream::proxy()
+{
+  QMutexLocker locker(&index_access_lock_);
+
+  return proxy_;
+}
+
+int VideoStream::proxy_divider()
+{
+  QMutexLocker locker(&index_access_lock_);
+
+  return proxy_divider_;
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -59,6 +59,29 @@ public:
   bool load_frame_index(const QString& s);
   bool save_frame_index(const QString& s);
 
+  /**
+   * @brief Register a low resolution proxy of this stream
+   *
+   * @param footage
+   *
+   * Probed Footage of the proxy file. Its first video stream is used as the proxy.
+   *
+   * @param divider
+   *
+   * The divider the proxy was generated at.
+   */
+  void set_proxy(std::shared_ptr<Footage> footage, int divider);
+
+  /**
+   * @brief Returns the proxy of this stream or nullptr if there isn't one
+   */
+  std::shared_ptr<VideoStream> proxy();
+
+  /**
+   * @brief Returns the divider the proxy was generated at or 0 if there isn't one
+   */
+  int proxy_divider();
+
 private:
   rational frame_rate_;
 
@@ -70,6 +93,12 @@ private:
 
   bool is_image_sequence_;
 
+  std::shared_ptr<Footage> proxy_footage_;
+
+  std::shared_ptr<VideoStream> proxy_;
+
+  int proxy_divider_;
+
 };
 
 using VideoStreamPtr = std::shared_ptr<VideoStream>;
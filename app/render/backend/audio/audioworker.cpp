@@ -73,26 +73,52 @@ void AudioWorker::RunNodeAccelerated(const Node *node, const TimeRange &range, N
 
   int sample_count = input_buffer->sample_count_per_channel();
 
-  // FIXME: Hardcoded float sample format
-  for (int i=0;i<sample_count;i++) {
-    // Calculate the exact rational time at this sample
-    int sample_out_of_channel = i / audio_params().channel_count();
-    double sample_to_second = static_cast<double>(sample_out_of_channel) / static_cast<double>(audio_params().sample_rate());
+  // Calculate the exact rational time of every sample
+  QVector<rational> sample_times(sample_count);
 
-    rational this_sample_time = rational::fromDouble(range.in().toDouble() + sample_to_second);
-
-    // Update all non-sample and non-footage inputs
-    foreach (NodeParam* param, node->parameters()) {
-      if (param->type() == NodeParam::kInput
-          && param != sample_input) {
-        NodeInput* input = static_cast<NodeInput*>(param);
+  for (int i=0;i<sample_count;i++) {
+    sample_times[i] = range.in() + rational(i, audio_params().sample_rate());
+  }
 
-        // If the input isn't keyframing, we don't need to update it unless it's connected, in which case it may change
-        if (input->IsConnected() || input->is_keyframing()) {
-          input_params.Insert(input, ProcessInput(input, TimeRange(this_sample_time, this_sample_time)));
+  // Find which non-sample and non-footage inputs need updating for each sample. If an input isn't keyframing, we don't
+  // need to update it unless it's connected, in which case it may change.
+  QVector<NodeInput*> per_sample_inputs;
+  QVector<NodeInput*> batched_inputs;
+  QVector< QVector<double> > batched_values;
+
+  foreach (NodeParam* param, node->parameters()) {
+    if (param->type() == NodeParam::kInput
+        && param != sample_input) {
+      NodeInput* input = static_cast<NodeInput*>(param);
+
+      if (input->IsConnected()) {
+        per_sample_inputs.append(input);
+      } else if (input->is_keyframing()) {
+        if (input->data_type() == NodeParam::kFloat) {
+          // Keyframed floats (e.g. volume) can be sampled for the whole buffer in one pass
+          batched_inputs.append(input);
+          batched_values.append(input->get_values_at_times_for_track(sample_times, 0));
+        } else {
+          per_sample_inputs.append(input);
         }
       }
     }
+  }
+
+  // FIXME: Hardcoded float sample format
+  for (int i=0;i<sample_count;i++) {
+    const rational& this_sample_time = sample_times.at(i);
+
+    for (int j=0;j<batched_inputs.size();j++) {
+      NodeValueTable table;
+      table.Push(NodeParam::kFloat, batched_values.at(j).at(i));
+      input_params.Insert(batched_inputs.at(j), table);
+    }
+
+    // Each sample time is only traversed once, so there's no point keeping these values for reuse
+    foreach (NodeInput* input, per_sample_inputs) {
+      input_params.Insert(input, ProcessInput(input, TimeRange(this_sample_time, this_sample_time), false));
+    }
 
     node->ProcessSamples(input_params,
                          audio_params(),
@@ -20,12 +20,7 @@
 
 #include "audiorenderworker.h"
 
-#include <QDir>
-#include <QFloat16>
-
 #include "audio/audiomanager.h"
-#include "audio/sumsamples.h"
-#include "config/config.h"
 #include "node/block/clip/clip.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -98,56 +93,12 @@ NodeValueTable AudioRenderWorker::RenderBlock(const TrackOutput *track, const Ti
     // Copy samples into destination buffer
     block_range_buffer->set(samples_from_this_block->const_data(), destination_offset, copy_length);
 
-    {
-      // Save waveform to file
-      Block* src_block = static_cast<Block*>(copy_map_->value(b));
-      QDir local_appdata_dir(Config::Current()["DiskCachePath"].toString());
-      QDir waveform_loc = local_appdata_dir.filePath(QStringLiteral("waveform"));
-      waveform_loc.mkpath(".");
-      QString wave_fn(waveform_loc.filePath(QString::number(reinterpret_cast<quintptr>(src_block))));
-      QFile wave_file(wave_fn);
-
-      if (wave_file.open(QFile::ReadWrite)) {
-        // We use S32 as a size-compatible substitute for SampleSummer::Sum which is 4 bytes in size
-        AudioRenderingParams waveform_params(SampleSummer::kSumSampleRate, audio_params_.channel_layout(), SampleFormat::SAMPLE_FMT_S32);
-        int chunk_size = (audio_params().sample_rate() / waveform_params.sample_rate());
-
-        qint64 start_offset = waveform_params.time_to_bytes(range_for_block.in() - b->in());
-        qint64 length_offset = waveform_params.time_to_bytes(range_for_block.length());
-        qint64 end_offset = start_offset + length_offset;
-
-        if (wave_file.size() < end_offset) {
-          wave_file.resize(end_offset);
-        }
-
-        wave_file.seek(start_offset);
-
-        for (int i=0;i<samples_from_this_block->sample_count_per_channel();i+=chunk_size) {
-          QVector<SampleSummer::Sum> summary = SampleSummer::SumSamples(samples_from_this_block,
-                                                                        i,
-                                                                        qMin(chunk_size, samples_from_this_block->sample_count_per_channel() - i));
-
-          wave_file.write(reinterpret_cast<const char*>(summary.constData()),
-                          summary.size() * sizeof(SampleSummer::Sum));
-        }
-
-        wave_file.close();
-
-        // Write metadata about this waveform file
-        QFile wave_metadata(wave_fn.append(QStringLiteral(".meta")));
-        if (wave_metadata.open(QFile::WriteOnly)) {
-          SampleSummer::Info info;
-          info.channels = audio_params_.channel_count();
-
-          wave_metadata.write(reinterpret_cast<char*>(&info), sizeof(SampleSummer::Info));
-
-          wave_metadata.close();
-        }
+    // Waveforms are drawn from the source stream's WaveformPyramid, so all that's needed here is a redraw now that
+    // this block's audio is available
+    Block* src_block = static_cast<Block*>(copy_map_->value(b));
 
-        if (src_block->type() == Block::kClip) {
-          emit static_cast<ClipBlock*>(src_block)->PreviewUpdated();
-        }
-      }
+    if (src_block && src_block->type() == Block::kClip) {
+      emit static_cast<ClipBlock*>(src_block)->PreviewUpdated();
     }
 
     NodeValueTable::Merge({merged_table, table});
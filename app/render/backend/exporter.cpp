@@ -20,6 +20,8 @@
 
 #include "exporter.h"
 
+#include <QSet>
+
 #include "render/backend/audio/audiobackend.h"
 #include "render/backend/opengl/openglbackend.h"
 #include "render/colormanager.h"
@@ -237,13 +239,11 @@ void Exporter::FrameRendered(const rational &time, FramePtr value)
 {
   debug_timer_.stop();
 
-  const QMap<rational, QByteArray>& time_hash_map = video_backend_->frame_cache()->time_hash_map();
-
-  QByteArray this_hash = time_hash_map.value(time);
+  QByteArray this_hash = video_backend_->frame_cache()->TimeToHash(time);
 
   qDebug() << "Received" << this_hash.toHex();
 
-  QList<rational> matching_times = time_hash_map.keys(this_hash);
+  QList<rational> matching_times = video_backend_->frame_cache()->FramesWithHash(this_hash);
 
   foreach (const rational& t, matching_times) {
     qDebug() << "  Matches" << t.toDouble();
@@ -332,14 +332,14 @@ void Exporter::VideoHashesComplete()
 
   // Remove duplicate frames from cache invalidation
   const QMap<rational, QByteArray>& time_hash_map = video_backend_->frame_cache()->time_hash_map();
-  QList<QByteArray> hashes_already_seen;
+  QSet<QByteArray> hashes_already_seen;
   QMap<rational, QByteArray>::const_iterator i;
 
   for (i=time_hash_map.begin(); i!=time_hash_map.end(); i++) {
     if (hashes_already_seen.contains(i.value())) {
       ranges.RemoveTimeRange(TimeRange(i.key(), i.key() + params_.video_params().time_base()));
     } else {
-      hashes_already_seen.append(i.value());
+      hashes_already_seen.insert(i.value());
     }
   }
 
@@ -20,6 +20,8 @@
 
 #include "indexmanager.h"
 
+#include "codec/decoder.h"
+#include "config/config.h"
 #include "task/taskmanager.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -72,6 +74,26 @@ void IndexManager::StartConformingStream(AudioStreamPtr stream, AudioRenderingPa
   TaskManager::instance()->AddTask(conform_task);
 }
 
+void IndexManager::StartProxyingStream(StreamPtr stream)
+{
+  if (stream->type() != Stream::kVideo || IsProxying(stream)) {
+    return;
+  }
+
+  // Proxies take a long time to generate and a lot of disk space, so they're only made if the user asked for them
+  if (!Config::Current()["GenerateProxies"].toBool()) {
+    return;
+  }
+
+  ProxyTask* proxy_task = new ProxyTask(std::static_pointer_cast<VideoStream>(stream), Decoder::kProxyDivider);
+  proxying_.append({stream, proxy_task});
+
+  connect(proxy_task, &ProxyTask::Succeeded, this, &IndexManager::ProxyTaskFinished, Qt::QueuedConnection);
+  connect(proxy_task, &ProxyTask::Failed, this, &IndexManager::ProxyTaskFinished, Qt::QueuedConnection);
+
+  TaskManager::instance()->AddTask(proxy_task);
+}
+
 bool IndexManager::IsIndexing(StreamPtr stream) const
 {
   foreach (const IndexPair& stp, indexing_) {
@@ -94,6 +116,17 @@ bool IndexManager::IsConforming(AudioStreamPtr stream, const AudioRenderingParam
   return false;
 }
 
+bool IndexManager::IsProxying(StreamPtr stream) const
+{
+  foreach (const ProxyPair& pxp, proxying_) {
+    if (pxp.stream == stream) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void IndexManager::IndexTaskFinished()
 {
   for (int i=0;i<indexing_.size();i++) {
@@ -106,6 +139,18 @@ void IndexManager::IndexTaskFinished()
   }
 }
 
+void IndexManager::ProxyTaskFinished()
+{
+  for (int i=0;i<proxying_.size();i++) {
+    const ProxyPair& pxp = proxying_.at(i);
+
+    if (pxp.task == sender()) {
+      proxying_.removeAt(i);
+      return;
+    }
+  }
+}
+
 void IndexManager::StreamIndexUpdatedEvent()
 {
   emit StreamIndexUpdated(static_cast<Stream*>(sender()));
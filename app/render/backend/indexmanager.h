@@ -26,6 +26,7 @@
 #include "project/item/footage/stream.h"
 #include "task/conform/conform.h"
 #include "task/index/index.h"
+#include "task/proxy/proxy.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -41,10 +42,12 @@ public:
 
   bool IsIndexing(StreamPtr stream) const;
   bool IsConforming(AudioStreamPtr stream, const AudioRenderingParams& params) const;
+  bool IsProxying(StreamPtr stream) const;
 
 public slots:
   void StartIndexingStream(OLIVE_NAMESPACE::StreamPtr stream);
   void StartConformingStream(OLIVE_NAMESPACE::AudioStreamPtr stream, OLIVE_NAMESPACE::AudioRenderingParams params);
+  void StartProxyingStream(OLIVE_NAMESPACE::StreamPtr stream);
 
 signals:
   void StreamIndexUpdated(Stream* stream);
@@ -66,11 +69,20 @@ private:
 
   QList<IndexPair> indexing_;
 
+  struct ProxyPair {
+    StreamPtr stream;
+    ProxyTask* task;
+  };
+
   QList<ConformPair> conforming_;
 
+  QList<ProxyPair> proxying_;
+
 private slots:
   void IndexTaskFinished();
 
+  void ProxyTaskFinished();
+
   void StreamIndexUpdatedEvent();
 
   void StreamConformAppendedEvent(const AudioRenderingParams& params);
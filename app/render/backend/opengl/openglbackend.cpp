@@ -68,6 +68,7 @@ bool OpenGLBackend::InitInternal()
     processors_.append(processor);
 
     connect(processor, &OpenGLWorker::RequestFrameToValue, proxy_, &OpenGLProxy::FrameToValue, Qt::BlockingQueuedConnection);
+    connect(processor, &OpenGLWorker::RequestYUVFrameToValue, proxy_, &OpenGLProxy::YUVFrameToValue, Qt::BlockingQueuedConnection);
     connect(processor, &OpenGLWorker::RequestTextureToBuffer, proxy_, &OpenGLProxy::TextureToBuffer, Qt::BlockingQueuedConnection);
     connect(processor, &OpenGLWorker::RequestRunNodeAccelerated, proxy_, &OpenGLProxy::RunNodeAccelerated, Qt::BlockingQueuedConnection);
   }
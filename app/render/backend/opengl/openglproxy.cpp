@@ -20,7 +20,9 @@
 
 #include "openglproxy.h"
 
+#include <QGenericMatrix>
 #include <QThread>
+#include <QVector3D>
 
 #include "common/clamp.h"
 #include "core.h"
@@ -94,14 +96,7 @@ void OpenGLProxy::FrameToValue(FramePtr frame, StreamPtr stream, NodeValueTable*
   }
 
   if (!footage_tex_ref) {
-    OpenGLColorProcessorPtr color_processor = std::static_pointer_cast<OpenGLColorProcessor>(color_cache_.Get(colorspace_match));
-
-    if (!color_processor) {
-      color_processor = OpenGLColorProcessor::Create(video_stream->footage()->project()->color_manager(),
-                                                     video_stream->colorspace(),
-                                                     video_stream->footage()->project()->color_manager()->GetReferenceColorSpace());
-      color_cache_.Add(colorspace_match, color_processor);
-    }
+    OpenGLColorProcessorPtr color_processor = GetColorProcessor(video_stream, colorspace_match);
 
     ColorManager::OCIOMethod ocio_method = ColorManager::GetOCIOMethodForMode(video_params_.mode());
 
@@ -135,64 +130,140 @@ void OpenGLProxy::FrameToValue(FramePtr frame, StreamPtr stream, NodeValueTable*
     footage_tex_ref = texture_cache_.Get(ctx_, footage_params, frame->data(), frame->linesize_pixels());
 
     if (ocio_method == ColorManager::kOCIOFast) {
-      if (!color_processor->IsEnabled()) {
-        color_processor->Enable(ctx_, video_stream->premultiplied_alpha());
-      }
+      footage_tex_ref = ProcessOCIO(footage_tex_ref,
+                                    frame->sample_aspect_ratio(),
+                                    color_processor,
+                                    video_stream->premultiplied_alpha());
+    }
 
-      // Check frame aspect ratio
-      if (frame->sample_aspect_ratio() != 1 && frame->sample_aspect_ratio() != 0) {
-        int new_width = frame->width();
-        int new_height = frame->height();
+    if (stream->type() == Stream::kImage) {
+      // Since this is a still image, we could likely optimize this
+      still_image_cache_.Add(stream.get(), {footage_tex_ref, colorspace_match, video_stream->premultiplied_alpha(), video_params_.divider()});
+    }
+  }
 
-        // Scale the frame in a way that does not reduce the resolution
-        if (frame->sample_aspect_ratio() > 1) {
-          // Make wider
-          new_width = qRound(static_cast<double>(new_width) * frame->sample_aspect_ratio().toDouble());
-        } else {
-          // Make taller
-          new_height = qRound(static_cast<double>(new_height) / frame->sample_aspect_ratio().toDouble());
-        }
+  table->Push(NodeParam::kTexture, QVariant::fromValue(footage_tex_ref));
+}
 
-        footage_params = VideoRenderingParams(new_width,
-                                              new_height,
-                                              footage_params.format());
-      }
+void OpenGLProxy::YUVFrameToValue(YUVFramePtr frame, StreamPtr stream, NodeValueTable *table)
+{
+  // Y'CbCr frames are only retrieved for video streams in offline mode, where OCIO runs on the GPU anyway
+  if (stream->type() != Stream::kVideo) {
+    return;
+  }
 
-      VideoRenderingParams dest_params(footage_params.width(),
-                                       footage_params.height(),
-                                       video_params_.format());
+  ImageStreamPtr video_stream = std::static_pointer_cast<ImageStream>(stream);
 
-      // Create destination texture
-      OpenGLTextureCache::ReferencePtr associated_tex_ref = texture_cache_.Get(ctx_, dest_params);
+  QString colorspace_match = QStringLiteral("%1:%2").arg(video_stream->footage()->project()->color_manager()->GetConfigFilename(), video_stream->colorspace());
 
-      buffer_.Attach(associated_tex_ref->texture(), true);
-      buffer_.Bind();
-      footage_tex_ref->texture()->Bind();
+  OpenGLColorProcessorPtr color_processor = GetColorProcessor(video_stream, colorspace_match);
 
-      // Set viewport for texture size
-      functions_->glViewport(0, 0, associated_tex_ref->texture()->width(), associated_tex_ref->texture()->height());
+  if (!yuv_pipeline_) {
+    yuv_pipeline_ = OpenGLShader::CreateYUVToRGB();
+  }
 
-      // Blit old texture to new texture through OCIO shader
-      color_processor->ProcessOpenGL();
+  // Upload each plane as a single channel texture
+  for (int i=0;i<YUVFrame::kPlaneCount;i++) {
+    UploadYUVPlane(frame, i);
+  }
 
-      footage_tex_ref->texture()->Release();
-      buffer_.Release();
-      buffer_.Detach();
+  // Calculate normalization for the frame's bit depth and range
+  double max_value = (frame->bytes_per_sample() == 2) ? 65535.0 : 255.0;
+  double depth_multiplier = (frame->bytes_per_sample() == 2) ? 256.0 : 1.0;
 
-      footage_tex_ref = associated_tex_ref;
-    }
+  QVector3D yuv_offset;
+  QVector3D yuv_scale;
 
-    if (stream->type() == Stream::kImage) {
-      // Since this is a still image, we could likely optimize this
-      still_image_cache_.Add(stream.get(), {footage_tex_ref, colorspace_match, video_stream->premultiplied_alpha(), video_params_.divider()});
-    }
+  if (frame->full_range()) {
+    float chroma_offset = static_cast<float>(128.0 * depth_multiplier / max_value);
+
+    yuv_offset = QVector3D(0.0f, chroma_offset, chroma_offset);
+    yuv_scale = QVector3D(1.0f, 1.0f, 1.0f);
+  } else {
+    float chroma_scale = static_cast<float>(max_value / (224.0 * depth_multiplier));
+
+    yuv_offset = QVector3D(static_cast<float>(16.0 * depth_multiplier / max_value),
+                           static_cast<float>(128.0 * depth_multiplier / max_value),
+                           static_cast<float>(128.0 * depth_multiplier / max_value));
+    yuv_scale = QVector3D(static_cast<float>(max_value / (219.0 * depth_multiplier)),
+                          chroma_scale,
+                          chroma_scale);
+  }
+
+  // Derive the conversion matrix from the luma coefficients of this color matrix
+  float kr, kb;
+
+  switch (frame->color_matrix()) {
+  case YUVFrame::kRec601:
+    kr = 0.299f;
+    kb = 0.114f;
+    break;
+  case YUVFrame::kRec2020:
+    kr = 0.2627f;
+    kb = 0.0593f;
+    break;
+  case YUVFrame::kRec709:
+  default:
+    kr = 0.2126f;
+    kb = 0.0722f;
+    break;
   }
 
+  float kg = 1.0f - kr - kb;
+
+  const float yuv_matrix_values[] = {
+    1.0f, 0.0f,                             2.0f * (1.0f - kr),
+    1.0f, -2.0f * kb * (1.0f - kb) / kg,    -2.0f * kr * (1.0f - kr) / kg,
+    1.0f, 2.0f * (1.0f - kb),               0.0f
+  };
+
+  // Convert to RGB in a texture of the render format
+  OpenGLTextureCache::ReferencePtr rgb_tex_ref = texture_cache_.Get(ctx_, VideoRenderingParams(frame->width(),
+                                                                                              frame->height(),
+                                                                                              video_params_.format()));
+
+  buffer_.Attach(rgb_tex_ref->texture(), true);
+  buffer_.Bind();
+
+  for (int i=0;i<YUVFrame::kPlaneCount;i++) {
+    functions_->glActiveTexture(GL_TEXTURE0 + i);
+    functions_->glBindTexture(GL_TEXTURE_2D, yuv_planes_[i].texture);
+  }
+
+  functions_->glViewport(0, 0, frame->width(), frame->height());
+
+  yuv_pipeline_->bind();
+  yuv_pipeline_->setUniformValue("ove_utex", 1);
+  yuv_pipeline_->setUniformValue("ove_vtex", 2);
+  yuv_pipeline_->setUniformValue("ove_yuvoffset", yuv_offset);
+  yuv_pipeline_->setUniformValue("ove_yuvscale", yuv_scale);
+  yuv_pipeline_->setUniformValue("ove_yuvmat", QMatrix3x3(yuv_matrix_values));
+
+  OpenGLRenderFunctions::Blit(yuv_pipeline_);
+
+  yuv_pipeline_->release();
+
+  for (int i=YUVFrame::kPlaneCount-1;i>=0;i--) {
+    functions_->glActiveTexture(GL_TEXTURE0 + i);
+    functions_->glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  buffer_.Release();
+  buffer_.Detach();
+
+  // Transform to the reference space (and correct aspect ratio) just like an RGB frame
+  OpenGLTextureCache::ReferencePtr footage_tex_ref = ProcessOCIO(rgb_tex_ref,
+                                                                 frame->sample_aspect_ratio(),
+                                                                 color_processor,
+                                                                 video_stream->premultiplied_alpha());
+
   table->Push(NodeParam::kTexture, QVariant::fromValue(footage_tex_ref));
 }
 
 void OpenGLProxy::Close()
 {
+  ClearYUVPlanes();
+  yuv_pipeline_ = nullptr;
   shader_cache_.Clear();
   buffer_.Destroy();
   copy_pipeline_ = nullptr;
@@ -496,6 +567,135 @@ void OpenGLProxy::SetParameters(const VideoRenderingParams &params)
   }
 }
 
+OpenGLColorProcessorPtr OpenGLProxy::GetColorProcessor(ImageStreamPtr stream, const QString &colorspace_match)
+{
+  OpenGLColorProcessorPtr color_processor = std::static_pointer_cast<OpenGLColorProcessor>(color_cache_.Get(colorspace_match));
+
+  if (!color_processor) {
+    color_processor = OpenGLColorProcessor::Create(stream->footage()->project()->color_manager(),
+                                                   stream->colorspace(),
+                                                   stream->footage()->project()->color_manager()->GetReferenceColorSpace());
+    color_cache_.Add(colorspace_match, color_processor);
+  }
+
+  return color_processor;
+}
+
+OpenGLTextureCache::ReferencePtr OpenGLProxy::ProcessOCIO(OpenGLTextureCache::ReferencePtr footage_tex_ref,
+                                                          const rational &sample_aspect_ratio,
+                                                          OpenGLColorProcessorPtr color_processor,
+                                                          bool premultiplied_alpha)
+{
+  if (!color_processor->IsEnabled()) {
+    color_processor->Enable(ctx_, premultiplied_alpha);
+  }
+
+  int new_width = footage_tex_ref->texture()->width();
+  int new_height = footage_tex_ref->texture()->height();
+
+  // Check frame aspect ratio
+  if (sample_aspect_ratio != 1 && sample_aspect_ratio != 0) {
+    // Scale the frame in a way that does not reduce the resolution
+    if (sample_aspect_ratio > 1) {
+      // Make wider
+      new_width = qRound(static_cast<double>(new_width) * sample_aspect_ratio.toDouble());
+    } else {
+      // Make taller
+      new_height = qRound(static_cast<double>(new_height) / sample_aspect_ratio.toDouble());
+    }
+  }
+
+  VideoRenderingParams dest_params(new_width,
+                                   new_height,
+                                   video_params_.format());
+
+  // Create destination texture
+  OpenGLTextureCache::ReferencePtr associated_tex_ref = texture_cache_.Get(ctx_, dest_params);
+
+  buffer_.Attach(associated_tex_ref->texture(), true);
+  buffer_.Bind();
+  footage_tex_ref->texture()->Bind();
+
+  // Set viewport for texture size
+  functions_->glViewport(0, 0, associated_tex_ref->texture()->width(), associated_tex_ref->texture()->height());
+
+  // Blit old texture to new texture through OCIO shader
+  color_processor->ProcessOpenGL();
+
+  footage_tex_ref->texture()->Release();
+  buffer_.Release();
+  buffer_.Detach();
+
+  return associated_tex_ref;
+}
+
+void OpenGLProxy::UploadYUVPlane(YUVFramePtr frame, int plane)
+{
+  YUVPlaneTexture& tex = yuv_planes_[plane];
+
+  int width = frame->plane_width(plane);
+  int height = frame->plane_height(plane);
+  int bytes_per_sample = frame->bytes_per_sample();
+
+  GLenum pixel_type = (bytes_per_sample == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+
+  functions_->glActiveTexture(GL_TEXTURE0);
+
+  if (!tex.texture) {
+    functions_->glGenTextures(1, &tex.texture);
+  }
+
+  functions_->glBindTexture(GL_TEXTURE_2D, tex.texture);
+  functions_->glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->plane_linesize_samples(plane));
+
+  if (tex.width == width && tex.height == height && tex.bytes_per_sample == bytes_per_sample) {
+    // Re-use existing storage
+    functions_->glTexSubImage2D(GL_TEXTURE_2D,
+                                0,
+                                0,
+                                0,
+                                width,
+                                height,
+                                GL_RED,
+                                pixel_type,
+                                frame->const_plane_data(plane));
+  } else {
+    functions_->glTexImage2D(GL_TEXTURE_2D,
+                             0,
+                             (bytes_per_sample == 2) ? GL_R16 : GL_R8,
+                             width,
+                             height,
+                             0,
+                             GL_RED,
+                             pixel_type,
+                             frame->const_plane_data(plane));
+
+    // Chroma planes are upsampled bilinearly by the sampler
+    functions_->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    functions_->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    functions_->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    functions_->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    tex.width = width;
+    tex.height = height;
+    tex.bytes_per_sample = bytes_per_sample;
+  }
+
+  functions_->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  functions_->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OpenGLProxy::ClearYUVPlanes()
+{
+  for (int i=0;i<YUVFrame::kPlaneCount;i++) {
+    if (yuv_planes_[i].texture && functions_) {
+      functions_->glDeleteTextures(1, &yuv_planes_[i].texture);
+    }
+
+    yuv_planes_[i] = YUVPlaneTexture();
+  }
+}
+
 void OpenGLProxy::FinishInit()
 {
   // Make context current on that surface
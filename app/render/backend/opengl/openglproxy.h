@@ -25,6 +25,8 @@
 #include <QOpenGLContext>
 
 #include "../videorenderworker.h"
+#include "codec/yuvframe.h"
+#include "openglcolorprocessor.h"
 #include "openglframebuffer.h"
 #include "openglshadercache.h"
 #include "opengltexturecache.h"
@@ -65,6 +67,11 @@ public:
 
   void FrameToValue(FramePtr frame, StreamPtr stream, NodeValueTable* table);
 
+  /**
+   * @brief Uploads Y'CbCr planes as-is and converts them to RGB on the GPU before color managing them
+   */
+  void YUVFrameToValue(YUVFramePtr frame, StreamPtr stream, NodeValueTable* table);
+
   void RunNodeAccelerated(const Node *node, const TimeRange &range, NodeValueDatabase &input_params, NodeValueTable& output_params);
 
   void TextureToBuffer(const QVariant& texture, int width, int height, const QMatrix4x4& matrix, void *buffer, int linesize);
@@ -72,6 +79,20 @@ public:
   void SetParameters(const VideoRenderingParams& params);
 
 private:
+  OpenGLColorProcessorPtr GetColorProcessor(ImageStreamPtr stream, const QString& colorspace_match);
+
+  /**
+   * @brief Transforms a footage texture to the reference space, stretching it to square pixels if necessary
+   */
+  OpenGLTextureCache::ReferencePtr ProcessOCIO(OpenGLTextureCache::ReferencePtr footage_tex_ref,
+                                               const rational& sample_aspect_ratio,
+                                               OpenGLColorProcessorPtr color_processor,
+                                               bool premultiplied_alpha);
+
+  void UploadYUVPlane(YUVFramePtr frame, int plane);
+
+  void ClearYUVPlanes();
+
   QOpenGLContext* ctx_;
   QOffscreenSurface surface_;
 
@@ -85,6 +106,17 @@ private:
 
   OpenGLShaderPtr copy_pipeline_;
 
+  OpenGLShaderPtr yuv_pipeline_;
+
+  struct YUVPlaneTexture {
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+    int bytes_per_sample = 0;
+  };
+
+  YUVPlaneTexture yuv_planes_[YUVFrame::kPlaneCount];
+
   OpenGLShaderCache shader_cache_;
 
   OpenGLTextureCache texture_cache_;
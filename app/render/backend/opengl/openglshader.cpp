@@ -149,6 +149,24 @@ OpenGLShaderPtr OpenGLShader::CreateOCIO(QOpenGLContext* ctx,
   return shader;
 }
 
+OpenGLShaderPtr OpenGLShader::CreateYUVToRGB()
+{
+  return CreateDefault(QStringLiteral("yuv_to_rgb"),
+                       QStringLiteral("uniform sampler2D ove_utex;\n"
+                                      "uniform sampler2D ove_vtex;\n"
+                                      "uniform vec3 ove_yuvoffset;\n"
+                                      "uniform vec3 ove_yuvscale;\n"
+                                      "uniform mat3 ove_yuvmat;\n"
+                                      "\n"
+                                      "vec4 yuv_to_rgb(vec4 y_sample) {\n"
+                                      "    vec3 yuv = vec3(y_sample.r,\n"
+                                      "                    texture(ove_utex, ove_texcoord).r,\n"
+                                      "                    texture(ove_vtex, ove_texcoord).r);\n"
+                                      "    yuv = (yuv - ove_yuvoffset) * ove_yuvscale;\n"
+                                      "    return vec4(ove_yuvmat * yuv, 1.0);\n"
+                                      "}\n"));
+}
+
 QString OpenGLShader::CodeDefaultFragment(const QString &function_name, const QString &shader_code)
 {
   QString frag_code = QStringLiteral("#version 150\n"
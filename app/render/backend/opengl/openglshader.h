@@ -51,6 +51,14 @@ public:
                                     OCIO::ConstProcessorRcPtr processor,
                                     bool alpha_is_associated);
 
+  /**
+   * @brief Creates a shader that converts planar Y'CbCr to RGB
+   *
+   * The luma plane is read from `ove_maintex` (texture unit 0) and the chroma planes from `ove_utex` and `ove_vtex`.
+   * Samples are normalized with `ove_yuvoffset` and `ove_yuvscale` and then converted with the `ove_yuvmat` matrix.
+   */
+  static OpenGLShaderPtr CreateYUVToRGB();
+
   static QString CodeDefaultFragment(const QString &function_name = QString(),
                                      const QString &shader_code = QString());
   static QString CodeDefaultVertex();
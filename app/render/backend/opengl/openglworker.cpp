@@ -38,6 +38,17 @@ OpenGLWorker::OpenGLWorker(VideoRenderFrameCache *frame_cache, QObject *parent)
 
 void OpenGLWorker::FrameToValue(DecoderPtr decoder, StreamPtr stream, const TimeRange &range, NodeValueTable *table)
 {
+  // When OCIO runs on the GPU anyway, skip the CPU RGB conversion and let the GPU convert from Y'CbCr too
+  if (stream->type() == Stream::kVideo
+      && ColorManager::GetOCIOMethodForMode(video_params().mode()) == ColorManager::kOCIOFast) {
+    YUVFramePtr yuv_frame = decoder->RetrieveVideoYUV(range.in(), video_params().divider());
+
+    if (yuv_frame) {
+      emit RequestYUVFrameToValue(yuv_frame, stream, table);
+      return;
+    }
+  }
+
   FramePtr frame = decoder->RetrieveVideo(range.in(), video_params().divider());
 
   if (frame) {
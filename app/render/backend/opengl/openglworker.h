@@ -40,6 +40,8 @@ public:
 signals:
   void RequestFrameToValue(FramePtr frame, StreamPtr stream, NodeValueTable* table);
 
+  void RequestYUVFrameToValue(YUVFramePtr frame, StreamPtr stream, NodeValueTable* table);
+
   void RequestRunNodeAccelerated(const Node *node, const TimeRange &range, NodeValueDatabase &input_params, NodeValueTable& output_params);
 
   void RequestTextureToBuffer(const QVariant& texture, int width, int height, const QMatrix4x4& matrix, void *buffer, int linesize);
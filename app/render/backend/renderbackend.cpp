@@ -29,6 +29,8 @@
 
 OLIVE_NAMESPACE_ENTER
 
+const int RenderBackend::kJobsQueuedPerWorker = 2;
+
 RenderBackend::RenderBackend(QObject *parent) :
   QObject(parent),
   compiled_(false),
@@ -166,6 +168,9 @@ bool RenderBackend::Compile()
   // Copy connections
   Node::DuplicateConnectionsBetweenLists(source_node_list_, copied_graph_.nodes());
 
+  // Resolve the copied graph's connections once here so workers don't need to walk them for every frame
+  execution_plan_.Compile(copied_graph_.nodes());
+
   compiled_ = CompileInternal();
 
   if (!compiled_) {
@@ -183,6 +188,7 @@ void RenderBackend::Decompile()
 
   DecompileInternal();
 
+  execution_plan_.Clear();
   copied_graph_.Clear();
   copied_viewer_node_ = nullptr;
   source_node_list_.clear();
@@ -227,6 +233,20 @@ TimeRange RenderBackend::PopNextFrameFromQueue()
   return cache_queue_.takeFirst();
 }
 
+QByteArray RenderBackend::TakeJobHash(const TimeRange &frame)
+{
+  Q_UNUSED(frame)
+
+  return QByteArray();
+}
+
+bool RenderBackend::DispatchQueueBatch(Node *node_connected_to_viewer)
+{
+  Q_UNUSED(node_connected_to_viewer)
+
+  return false;
+}
+
 rational RenderBackend::GetSequenceLength()
 {
   if (viewer_node_ == nullptr) {
@@ -253,6 +273,9 @@ void RenderBackend::DisconnectViewer(ViewerOutput *node)
 
 void RenderBackend::CacheNext()
 {
+  // Make sure any jobs still queued are being worked on
+  WakeIdleWorkers();
+
   if (cache_queue_.isEmpty()) {
     if (AllProcessorsAreAvailable()) {
       emit QueueComplete();
@@ -276,8 +299,14 @@ void RenderBackend::CacheNext()
     recompile_queued_ = false;
   }
 
-  if (!compiled_ && !Compile()) {
-    return;
+  bool graph_changed = false;
+
+  if (!compiled_) {
+    if (!Compile()) {
+      return;
+    }
+
+    graph_changed = true;
   }
 
   if (input_update_queued_) {
@@ -289,6 +318,16 @@ void RenderBackend::CacheNext()
     }
 
     input_update_queued_ = false;
+
+    graph_changed = true;
+  }
+
+  if (graph_changed) {
+    // Workers may have cached data about the graph that's no longer valid. This is queued before any new render jobs
+    // so it'll always be processed first.
+    foreach (RenderWorker* worker, processors_) {
+      QMetaObject::invokeMethod(worker, "GraphChanged", Qt::QueuedConnection);
+    }
   }
 
   Node* node_connected_to_viewer = GetDependentInput()->get_connected_node();
@@ -297,41 +336,38 @@ void RenderBackend::CacheNext()
     return;
   }
 
-  foreach (RenderWorker* worker, processors_) {
-    if (cache_queue_.isEmpty()) {
-      break;
-    }
+  if (DispatchQueueBatch(node_connected_to_viewer)) {
+    return;
+  }
 
-    if (!WorkerIsBusy(worker)) {
-      TimeRange cache_frame = PopNextFrameFromQueue();
+  // Top up the job queue, workers take jobs from it on their own threads
+  while (!cache_queue_.isEmpty()
+         && job_queue_.Size() < processors_.size() * kJobsQueuedPerWorker) {
+    TimeRange cache_frame = PopNextFrameFromQueue();
 
-      NodeDependency dep = NodeDependency(node_connected_to_viewer,
-                                          cache_frame);
+    NodeDependency dep = NodeDependency(node_connected_to_viewer,
+                                        cache_frame);
 
-      // Timestamp this render job
-      qint64 job_time = QDateTime::currentMSecsSinceEpoch();
+    // Timestamp this render job
+    qint64 job_time = QDateTime::currentMSecsSinceEpoch();
 
-      // Ensure the job's time is unique (since that's the whole point)
-      // NOTE: This value will be 0 if it doesn't exist, which will never be the result of currentMSecsSinceEpoch so we
-      //       can safely assume 0 means it doesn't exist.
-      qint64 existing_job_time = render_job_info_.value(cache_frame);
+    // Ensure the job's time is unique (since that's the whole point)
+    // NOTE: This value will be 0 if it doesn't exist, which will never be the result of currentMSecsSinceEpoch so we
+    //       can safely assume 0 means it doesn't exist.
+    qint64 existing_job_time = render_job_info_.value(cache_frame);
 
-      if (existing_job_time == job_time) {
-        job_time = existing_job_time + 1;
-      }
+    if (existing_job_time == job_time) {
+      job_time = existing_job_time + 1;
+    }
 
-      render_job_info_.insert(cache_frame, job_time);
+    render_job_info_.insert(cache_frame, job_time);
 
-      SetWorkerBusyState(worker, true);
-      cancel_dialog_->WorkerStarted();
+    cancel_dialog_->WorkerStarted();
 
-      QMetaObject::invokeMethod(worker,
-                                "Render",
-                                Qt::QueuedConnection,
-                                OLIVE_NS_ARG(NodeDependency, dep),
-                                Q_ARG(qint64, job_time));
-    }
+    job_queue_.Push({dep, job_time, TakeJobHash(cache_frame)});
   }
+
+  WakeIdleWorkers();
 }
 
 ViewerOutput *RenderBackend::viewer_node() const
@@ -343,6 +379,12 @@ void RenderBackend::CancelQueue()
 {
   cache_queue_.clear();
 
+  // Jobs that haven't been started yet will never complete
+  int cancelled_jobs = job_queue_.Clear();
+  for (int i=0;i<cancelled_jobs;i++) {
+    cancel_dialog_->WorkerDone();
+  }
+
   int busy = 0;
   for (int i=0;i<processor_busy_state_.size();i++) {
     if (processor_busy_state_.at(i))
@@ -404,6 +446,10 @@ void RenderBackend::SetWorkerBusyState(RenderWorker *worker, bool busy)
 
 bool RenderBackend::AllProcessorsAreAvailable() const
 {
+  if (!job_queue_.IsEmpty()) {
+    return false;
+  }
+
   foreach (bool busy, processor_busy_state_) {
     if (busy) {
       return false;
@@ -413,6 +459,23 @@ bool RenderBackend::AllProcessorsAreAvailable() const
   return true;
 }
 
+void RenderBackend::WakeIdleWorkers()
+{
+  if (job_queue_.IsEmpty()) {
+    return;
+  }
+
+  foreach (RenderWorker* worker, processors_) {
+    if (!WorkerIsBusy(worker)) {
+      SetWorkerBusyState(worker, true);
+
+      QMetaObject::invokeMethod(worker,
+                                "ProcessJobQueue",
+                                Qt::QueuedConnection);
+    }
+  }
+}
+
 const QVector<QThread *> &RenderBackend::threads()
 {
   return threads_;
@@ -433,6 +496,8 @@ void RenderBackend::CacheIDChangedEvent(const QString &id)
 
 void RenderBackend::InitWorkers()
 {
+  job_queue_.SetWorkerCount(processors_.size());
+
   for (int i=0;i<processors_.size();i++) {
     RenderWorker* processor = processors_.at(i);
     QThread* thread = threads().at(i);
@@ -440,6 +505,13 @@ void RenderBackend::InitWorkers()
     // Connect to it
     ConnectWorkerToThis(processor);
 
+    // Workers take their jobs from the shared queue
+    processor->SetJobQueue(&job_queue_, i);
+
+    // Workers traverse the compiled graph through the plan
+    processor->SetExecutionPlan(&execution_plan_);
+    connect(processor, &RenderWorker::JobQueueEmpty, this, &RenderBackend::WorkerJobQueueEmpty, Qt::QueuedConnection);
+
     // Connect cancel dialog to it
     connect(processor, &RenderWorker::CompletedCache, cancel_dialog_, &RenderCancelDialog::WorkerDone, Qt::QueuedConnection);
     connect(processor, &RenderWorker::FootageUnavailable, this, &RenderBackend::FootageUnavailable, Qt::QueuedConnection);
@@ -460,6 +532,13 @@ void RenderBackend::QueueRecompile()
   recompile_queued_ = true;
 }
 
+void RenderBackend::WorkerJobQueueEmpty()
+{
+  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
+
+  CacheNext();
+}
+
 void RenderBackend::FootageUnavailable(StreamPtr stream, Decoder::RetrieveState state, const TimeRange &range, const rational &stream_time)
 {
   if (state == Decoder::kFailedToOpen){
@@ -27,6 +27,7 @@
 #include "decodercache.h"
 #include "node/graph.h"
 #include "node/output/viewer/viewer.h"
+#include "renderjobqueue.h"
 #include "renderworker.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -76,6 +77,21 @@ protected:
 
   virtual TimeRange PopNextFrameFromQueue();
 
+  /**
+   * @brief Returns the hash already generated for a frame that's about to be dispatched
+   *
+   * Returns an empty array if the frame hasn't been hashed. The hash is passed to the worker with the job so it doesn't need to hash the frame again.
+   */
+  virtual QByteArray TakeJobHash(const TimeRange& frame);
+
+  /**
+   * @brief Called by CacheNext() before any frames are sent to workers individually
+   *
+   * Derivatives can use this to give workers jobs that cover several frames at once. Return true if frames should NOT
+   * be dispatched individually this time.
+   */
+  virtual bool DispatchQueueBatch(Node* node_connected_to_viewer);
+
   rational GetSequenceLength();
 
   const QVector<QThread*>& threads();
@@ -117,6 +133,11 @@ protected:
   bool WorkerIsBusy(RenderWorker* worker) const;
   void SetWorkerBusyState(RenderWorker* worker, bool busy);
 
+  /**
+   * @brief Start any idle workers on the jobs in the job queue
+   */
+  void WakeIdleWorkers();
+
   TimeRangeList cache_queue_;
 
   QVector<RenderWorker*> processors_;
@@ -129,6 +150,8 @@ protected:
 
   NodeGraph copied_graph_;
 
+  NodeExecutionPlan execution_plan_;
+
 protected slots:
   void QueueRecompile();
 
@@ -165,6 +188,18 @@ private:
 
   QVector<bool> processor_busy_state_;
 
+  /**
+   * @brief Jobs that workers take from directly so they never wait on the main thread between frames
+   */
+  RenderJobQueue job_queue_;
+
+  /**
+   * @brief Amount of jobs kept in job_queue_ per worker
+   *
+   * Kept low so that jobs are still pushed in an up-to-date order when the priorities change (e.g. the playhead moves).
+   */
+  static const int kJobsQueuedPerWorker;
+
   RenderCancelDialog* cancel_dialog_;
 
   struct FootageWaitInfo {
@@ -178,6 +213,8 @@ private:
   QList<FootageWaitInfo> footage_wait_info_;
 
 private slots:
+  void WorkerJobQueueEmpty();
+
   void FootageUnavailable(StreamPtr stream, Decoder::RetrieveState state, const TimeRange& path, const rational& stream_time);
 
   void IndexUpdated(Stream *stream);
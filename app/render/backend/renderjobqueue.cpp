@@ -0,0 +1,108 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderjobqueue.h"
+
+OLIVE_NAMESPACE_ENTER
+
+RenderJobQueue::RenderJobQueue() :
+  next_worker_(0)
+{
+}
+
+RenderJobQueue::~RenderJobQueue()
+{
+  qDeleteAll(worker_jobs_);
+}
+
+void RenderJobQueue::SetWorkerCount(int count)
+{
+  qDeleteAll(worker_jobs_);
+  worker_jobs_.resize(count);
+
+  for (int i=0;i<count;i++) {
+    worker_jobs_.replace(i, new WorkerJobs());
+  }
+
+  next_worker_ = 0;
+  size_.store(0);
+}
+
+void RenderJobQueue::Push(const RenderJobQueue::Job &job)
+{
+  if (worker_jobs_.isEmpty()) {
+    return;
+  }
+
+  WorkerJobs* list = worker_jobs_.at(next_worker_);
+
+  list->lock.lock();
+  list->jobs.append(job);
+  size_++;
+  list->lock.unlock();
+
+  next_worker_ = (next_worker_ + 1) % worker_jobs_.size();
+}
+
+bool RenderJobQueue::Take(int worker, RenderJobQueue::Job *job)
+{
+  // Start with this worker's own jobs and then try stealing from each of the others
+  for (int i=0;i<worker_jobs_.size();i++) {
+    WorkerJobs* list = worker_jobs_.at((worker + i) % worker_jobs_.size());
+
+    QMutexLocker locker(&list->lock);
+
+    if (!list->jobs.isEmpty()) {
+      // Jobs are pushed in order of priority so the first is always the most urgent
+      *job = list->jobs.takeFirst();
+      size_--;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int RenderJobQueue::Clear()
+{
+  int removed = 0;
+
+  foreach (WorkerJobs* list, worker_jobs_) {
+    QMutexLocker locker(&list->lock);
+
+    removed += list->jobs.size();
+    size_ -= list->jobs.size();
+    list->jobs.clear();
+  }
+
+  return removed;
+}
+
+int RenderJobQueue::Size() const
+{
+  return size_.load();
+}
+
+bool RenderJobQueue::IsEmpty() const
+{
+  return Size() == 0;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,96 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERJOBQUEUE_H
+#define RENDERJOBQUEUE_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QLinkedList>
+#include <QMutex>
+#include <QVector>
+
+#include "node/dependency.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Thread-safe queue of render jobs that RenderWorkers take from directly
+ *
+ * Each worker has its own list of jobs so workers rarely wait on each other. Jobs are spread across the lists as
+ * they're pushed, and a worker whose list is empty steals jobs from the others.
+ */
+class RenderJobQueue
+{
+public:
+  struct Job {
+    NodeDependency path;
+    qint64 job_time;
+
+    /// Hash of this frame if the backend already generated one, otherwise empty
+    QByteArray hash;
+  };
+
+  RenderJobQueue();
+
+  ~RenderJobQueue();
+
+  /**
+   * @brief Set the amount of workers taking from this queue
+   *
+   * Clears the queue. Must not be called while any worker is taking from it.
+   */
+  void SetWorkerCount(int count);
+
+  void Push(const Job& job);
+
+  /**
+   * @brief Take the next job for this worker, returns false if there are no jobs left
+   *
+   * This function is thread-safe.
+   */
+  bool Take(int worker, Job* job);
+
+  /**
+   * @brief Remove all jobs from the queue, returns how many were removed
+   */
+  int Clear();
+
+  int Size() const;
+
+  bool IsEmpty() const;
+
+private:
+  struct WorkerJobs {
+    QMutex lock;
+    QLinkedList<Job> jobs;
+  };
+
+  QVector<WorkerJobs*> worker_jobs_;
+
+  int next_worker_;
+
+  QAtomicInt size_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // RENDERJOBQUEUE_H
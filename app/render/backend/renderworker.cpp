@@ -28,7 +28,9 @@ OLIVE_NAMESPACE_ENTER
 
 RenderWorker::RenderWorker(QObject *parent) :
   QObject(parent),
-  started_(false)
+  started_(false),
+  job_queue_(nullptr),
+  job_queue_index_(0)
 {
 }
 
@@ -56,14 +58,39 @@ void RenderWorker::Close()
 
 void RenderWorker::Render(NodeDependency path, qint64 job_time)
 {
-  path_ = path;
+  RenderJob({path, job_time, QByteArray()});
+}
+
+void RenderWorker::ProcessJobQueue()
+{
+  RenderJobQueue::Job job;
+
+  if (job_queue_ && job_queue_->Take(job_queue_index_, &job)) {
+    RenderJob(job);
 
-  emit CompletedCache(path, RenderInternal(path, job_time), job_time);
+    // Come back for the next job through the event loop so any other events (e.g. GraphChanged) are handled in between
+    QMetaObject::invokeMethod(this, "ProcessJobQueue", Qt::QueuedConnection);
+  } else {
+    emit JobQueueEmpty();
+  }
 }
 
-NodeValueTable RenderWorker::RenderInternal(const NodeDependency &path, const qint64 &job_time)
+void RenderWorker::RenderJob(const RenderJobQueue::Job &job)
+{
+  path_ = job.path;
+
+  emit CompletedCache(job.path, RenderInternal(job.path, job.job_time, job.hash), job.job_time);
+}
+
+void RenderWorker::GraphChanged()
+{
+  GraphChangedEvent();
+}
+
+NodeValueTable RenderWorker::RenderInternal(const NodeDependency &path, const qint64 &job_time, const QByteArray &hash)
 {
   Q_UNUSED(job_time)
+  Q_UNUSED(hash)
 
   return ProcessNode(path);
 }
@@ -108,6 +135,12 @@ bool RenderWorker::IsStarted()
   return started_;
 }
 
+void RenderWorker::SetJobQueue(RenderJobQueue *queue, int index)
+{
+  job_queue_ = queue;
+  job_queue_index_ = index;
+}
+
 void RenderWorker::ReportUnavailableFootage(StreamPtr stream, Decoder::RetrieveState state, const rational& stream_time)
 {
   emit FootageUnavailable(stream, state, path_.range(), stream_time);
@@ -27,6 +27,7 @@
 #include "node/node.h"
 #include "node/output/track/track.h"
 #include "node/traverser.h"
+#include "renderjobqueue.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -40,14 +41,33 @@ public:
 
   bool IsStarted();
 
+  /**
+   * @brief Set the queue this worker takes jobs from when ProcessJobQueue() is called
+   *
+   * Must be called before the worker is moved to its thread.
+   */
+  void SetJobQueue(RenderJobQueue* queue, int index);
+
 public slots:
   void Close();
 
   void Render(OLIVE_NAMESPACE::NodeDependency path, qint64 job_time);
 
+  /**
+   * @brief Render jobs from the job queue until it's empty, then emit JobQueueEmpty()
+   */
+  void ProcessJobQueue();
+
+  /**
+   * @brief Notify the worker that the graph it's rendering has been recompiled or had its values updated
+   */
+  void GraphChanged();
+
 signals:
   void CompletedCache(OLIVE_NAMESPACE::NodeDependency dep, OLIVE_NAMESPACE::NodeValueTable data, qint64 job_time);
 
+  void JobQueueEmpty();
+
   void FootageUnavailable(OLIVE_NAMESPACE::StreamPtr stream, OLIVE_NAMESPACE::Decoder::RetrieveState state, const OLIVE_NAMESPACE::TimeRange& range, const OLIVE_NAMESPACE::rational& stream_time);
 
 protected:
@@ -55,7 +75,12 @@ protected:
 
   virtual void CloseInternal() = 0;
 
-  virtual NodeValueTable RenderInternal(const NodeDependency& CurrentPath, const qint64& job_time);
+  /**
+   * @brief Render a job
+   *
+   * `hash` is the hash the backend already generated for this job, or empty if it hasn't been hashed.
+   */
+  virtual NodeValueTable RenderInternal(const NodeDependency& CurrentPath, const qint64& job_time, const QByteArray& hash);
 
   virtual void RunNodeAccelerated(const Node *node, const TimeRange& range, NodeValueDatabase &input_params, NodeValueTable &output_params);
 
@@ -63,6 +88,8 @@ protected:
 
   virtual void ReportUnavailableFootage(StreamPtr stream, Decoder::RetrieveState state, const rational& stream_time);
 
+  virtual void GraphChangedEvent(){}
+
   virtual void InputProcessingEvent(NodeInput *input, const TimeRange &input_time, NodeValueTable* table) override;
 
   virtual void ProcessNodeEvent(const Node *node, const TimeRange &range, NodeValueDatabase &input_params, NodeValueTable &output_params) override;
@@ -74,12 +101,18 @@ protected:
   const NodeDependency& CurrentPath() const;
 
 private:
+  void RenderJob(const RenderJobQueue::Job& job);
+
   bool started_;
 
   DecoderCache decoder_cache_;
 
   NodeDependency path_;
 
+  RenderJobQueue* job_queue_;
+
+  int job_queue_index_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -20,6 +20,8 @@
 
 #include "videorenderbackend.h"
 
+#include <algorithm>
+#include <functional>
 #include <OpenImageIO/imageio.h>
 #include <QApplication>
 #include <QCryptographicHash>
@@ -29,19 +31,24 @@
 
 #include "common/timecodefunctions.h"
 #include "config/config.h"
-#include "render/diskmanager.h"
+#include "render/diskcachewriter.h"
 #include "render/diskmanager.h"
 #include "render/pixelformat.h"
 #include "videorenderworker.h"
 
 OLIVE_NAMESPACE_ENTER
 
+const int VideoRenderBackend::kMaxHashBatchSize = 512;
+const int VideoRenderBackend::kPausedBehindWeight = 2;
+const int VideoRenderBackend::kPlaybackBehindWeight = 8;
+
 VideoRenderBackend::VideoRenderBackend(QObject *parent) :
   RenderBackend(parent),
   operating_mode_(VideoRenderWorker::kHashRenderCache),
   only_signal_last_frame_requested_(true),
   limit_caching_(true),
-  pop_toggle_(false)
+  playback_speed_(0),
+  heap_playhead_(0)
 {
   connect(DiskManager::instance(), &DiskManager::DeletedFrame, this, &VideoRenderBackend::FrameRemovedFromDiskCache);
 }
@@ -92,6 +99,8 @@ void VideoRenderBackend::SetOperatingMode(const VideoRenderWorker::OperatingMode
 
   operating_mode_ = mode;
 
+  ResetHashBatches();
+
   foreach (RenderWorker* worker, processors_) {
     static_cast<VideoRenderWorker*>(worker)->SetOperatingMode(operating_mode_);
   }
@@ -113,7 +122,9 @@ bool VideoRenderBackend::IsRendered(const rational &time) const
 {
   TimeRange range(time, time);
 
-  return !TimeIsQueued(range) && !render_job_info_.contains(range);
+  return !TimeIsQueued(range)
+      && !render_job_info_.contains(range)
+      && !hashing_frames_.ContainsTimeRange(range, true, false);
 }
 
 void VideoRenderBackend::SetLimitCaching(bool limit)
@@ -139,6 +150,8 @@ bool VideoRenderBackend::GenerateCacheIDInternal(QCryptographicHash& hash)
 void VideoRenderBackend::CacheIDChangedEvent(const QString &id)
 {
   frame_cache_.SetCacheID(id);
+
+  ResetHashBatches();
 }
 
 void VideoRenderBackend::ConnectWorkerToThis(RenderWorker *processor)
@@ -152,6 +165,7 @@ void VideoRenderBackend::ConnectWorkerToThis(RenderWorker *processor)
   connect(video_processor, &VideoRenderWorker::HashAlreadyExists, this, &VideoRenderBackend::ThreadHashAlreadyExists, Qt::QueuedConnection);
   connect(video_processor, &VideoRenderWorker::GeneratedFrame, this, &VideoRenderBackend::GeneratedFrame, Qt::QueuedConnection);
   connect(video_processor, &VideoRenderWorker::GeneratedFrame, this, &VideoRenderBackend::ThreadGeneratedFrame, Qt::QueuedConnection);
+  connect(video_processor, &VideoRenderWorker::HashesGenerated, this, &VideoRenderBackend::ThreadGeneratedHashes, Qt::QueuedConnection);
 }
 
 void VideoRenderBackend::InvalidateCacheInternal(const rational &start_range, const rational &end_range)
@@ -160,6 +174,8 @@ void VideoRenderBackend::InvalidateCacheInternal(const rational &start_range, co
 
   invalidated_.InsertTimeRange(invalidated);
 
+  ResetHashBatches();
+
   emit RangeInvalidated(invalidated);
 
   Requeue();
@@ -170,7 +186,7 @@ VideoRenderFrameCache *VideoRenderBackend::frame_cache()
   return &frame_cache_;
 }
 
-QString VideoRenderBackend::GetCachedFrame(const rational &time)
+QString VideoRenderBackend::GetCachedFrame(const rational &time, FramePtr *memory_frame)
 {
   UpdateLastRequestedTime(time);
 
@@ -195,6 +211,20 @@ QString VideoRenderBackend::GetCachedFrame(const rational &time)
   if (!frame_hash.isEmpty()) {
     DiskManager::instance()->Accessed(frame_hash);
 
+    if (memory_frame) {
+      *memory_frame = DiskManager::instance()->GetFrameFromMemory(frame_hash);
+
+      if (!*memory_frame) {
+        // Evicted (or never kept in memory) before the disk cache writer finished with it
+        *memory_frame = DiskCacheWriter::instance()->GetPendingFrame(frame_hash);
+      }
+    }
+
+    if (DiskCacheWriter::instance()->IsPending(frame_hash)) {
+      // The file may still be incomplete, so don't hand its path out until it's been written
+      return QString();
+    }
+
     return frame_cache_.CachePathName(frame_hash, params_.format());
   }
 
@@ -208,6 +238,13 @@ void VideoRenderBackend::UpdateLastRequestedTime(const rational &time)
   Requeue();
 }
 
+void VideoRenderBackend::SetPlaybackSpeed(int speed)
+{
+  playback_speed_ = speed;
+
+  Requeue();
+}
+
 NodeInput *VideoRenderBackend::GetDependentInput()
 {
   return viewer_node()->texture_input();
@@ -220,43 +257,47 @@ bool VideoRenderBackend::CanRender()
 
 TimeRange VideoRenderBackend::PopNextFrameFromQueue()
 {
-  // Try to find the frame that's closest to the last time requested (the playhead)
-  rational earliest_allowed_time = (pop_toggle_) ? 0 : last_time_requested_;
-  pop_toggle_ = !pop_toggle_;
-
-  // Set up playhead frame range to see if the queue contains this frame precisely
-  TimeRange test_range(earliest_allowed_time, earliest_allowed_time + params_.time_base());
-
-  // Use this variable to find the closest frame in the range
-  rational closest_time = RATIONAL_MAX;
+  TimeRange frame_range;
 
-  foreach (const TimeRange& range_here, cache_queue_) {
-    if (range_here.OverlapsWith(test_range, false, false)) {
-      closest_time = RATIONAL_MAX;
-      break;
+  forever {
+    if (queue_heap_before_.isEmpty() && queue_heap_after_.isEmpty()) {
+      RebuildQueueHeap();
     }
 
-    if (range_here.in() >= earliest_allowed_time) {
-      rational frame_here = Timecode::snap_time_to_timebase(range_here.in(), params_.time_base());
+    if (queue_heap_before_.isEmpty() && queue_heap_after_.isEmpty()) {
+      // The queue only has ranges too short to contain a frame, just take the next one
+      TimeRange range = cache_queue_.first();
 
-      if (frame_here > range_here.in()) {
-        frame_here = qMax(rational(), frame_here - params_.time_base());
-      }
+      int64_t first, last;
+      GetFrameTimestamps(range, &first, &last);
 
-      closest_time = qMin(closest_time, frame_here);
+      frame_range = TimeRange(Timecode::timestamp_to_time(first, params_.time_base()), range.out());
+      break;
     }
-  }
 
-  TimeRange frame_range;
+    int64_t next;
+
+    // Take whichever of the closest frames either side of the playhead is the higher priority
+    if (queue_heap_before_.isEmpty()
+        || (!queue_heap_after_.isEmpty()
+            && GetFramePriority(queue_heap_after_.first()) <= GetFramePriority(queue_heap_before_.first()))) {
+      std::pop_heap(queue_heap_after_.begin(), queue_heap_after_.end(), std::greater<int64_t>());
+      next = queue_heap_after_.takeLast();
+    } else {
+      std::pop_heap(queue_heap_before_.begin(), queue_heap_before_.end());
+      next = queue_heap_before_.takeLast();
+    }
 
-  if (closest_time == RATIONAL_MAX) {
-    frame_range = test_range;
-  } else {
-    frame_range = TimeRange(closest_time, closest_time + params_.time_base());
+    // Skip frames that have been removed from the queue since they were pushed
+    if (queued_frames_.remove(next)) {
+      rational frame_start = Timecode::timestamp_to_time(next, params_.time_base());
+      frame_range = TimeRange(frame_start, frame_start + params_.time_base());
+      break;
+    }
   }
 
   // Remove this particular frame from the queue
-  cache_queue_.RemoveTimeRange(frame_range);
+  RemoveTimeRangeFromQueue(frame_range);
 
   // Remove this particular frame from missing frames
   invalidated_.RemoveTimeRange(frame_range);
@@ -265,59 +306,199 @@ TimeRange VideoRenderBackend::PopNextFrameFromQueue()
   return TimeRange(frame_range.in(), frame_range.in());
 }
 
-void VideoRenderBackend::ThreadCompletedDownload(NodeDependency dep, qint64 job_time, QByteArray hash, bool texture_existed)
+QByteArray VideoRenderBackend::TakeJobHash(const TimeRange &frame)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
+  return batch_hashes_.take(frame.in());
+}
 
-  SetFrameHash(dep, hash, job_time);
+bool VideoRenderBackend::DispatchQueueBatch(Node *node_connected_to_viewer)
+{
+  if (!(operating_mode_ & VideoRenderWorker::kHashOnly)) {
+    return false;
+  }
+
+  // Frames in running batches aren't in the queue, so this only finds frames nothing is hashing yet
+  TimeRangeList unhashed = cache_queue_;
+
+  foreach (const TimeRange& range, hashed_frames_) {
+    unhashed.RemoveTimeRange(range);
+  }
+
+  // Convert the unhashed ranges to frame timestamps
+  const rational& timebase = params_.time_base();
+  QList< QPair<int64_t, int64_t> > frame_ranges;
+  int64_t frame_count = 0;
+
+  foreach (const TimeRange& range, unhashed) {
+    int64_t first, last;
+    GetFrameTimestamps(range, &first, &last);
+
+    if (last > first) {
+      frame_ranges.append(qMakePair(first, last));
+      frame_count += last - first;
+    }
+  }
+
+  if (frame_ranges.isEmpty()) {
+    return false;
+  }
+
+  // Only idle workers are given batches. Workers that are busy rendering carry on, and frames that have already been
+  // hashed are still dispatched individually below.
+  QList<RenderWorker*> idle_workers;
+
+  foreach (RenderWorker* worker, processors_) {
+    if (!WorkerIsBusy(worker)) {
+      idle_workers.append(worker);
+    }
+  }
+
+  if (idle_workers.isEmpty()) {
+    return false;
+  }
+
+  // Split the frames evenly across the idle workers
+  int64_t batch_size = qBound(int64_t(1),
+                              (frame_count + idle_workers.size() - 1) / idle_workers.size(),
+                              int64_t(kMaxHashBatchSize));
+
+  qint64 job_time = QDateTime::currentMSecsSinceEpoch();
 
-  // Register frame with the disk manager
-  if (texture_existed && operating_mode_ & VideoRenderWorker::kDownloadOnly) {
-    DiskManager::instance()->CreatedFile(frame_cache()->CachePathName(hash, params_.format()), hash);
+  foreach (RenderWorker* worker, idle_workers) {
+    if (frame_ranges.isEmpty()) {
+      break;
+    }
+
+    QPair<int64_t, int64_t>& frames = frame_ranges.first();
+    int64_t batch_end = qMin(frames.first + batch_size, frames.second);
+
+    NodeDependency dep = NodeDependency(node_connected_to_viewer,
+                                        TimeRange(Timecode::timestamp_to_time(frames.first, timebase),
+                                                  Timecode::timestamp_to_time(batch_end, timebase)));
+
+    frames.first = batch_end;
+    if (frames.first == frames.second) {
+      frame_ranges.removeFirst();
+    }
+
+    // Take these frames out of the queue until they've been hashed
+    hashing_frames_.InsertTimeRange(dep.range());
+    RemoveTimeRangeFromQueue(dep.range());
+
+    SetWorkerBusyState(worker, true);
+    hash_batches_.insert(worker, true);
+
+    QMetaObject::invokeMethod(worker,
+                              "Hash",
+                              Qt::QueuedConnection,
+                              OLIVE_NS_ARG(NodeDependency, dep),
+                              Q_ARG(qint64, job_time));
   }
 
+  // Anything left in the queue (frames that have already been hashed, or more frames than the batches could take) can
+  // be rendered straight away
+  return false;
+}
+
+void VideoRenderBackend::ThreadCompletedDownload(NodeDependency dep, qint64 job_time, QByteArray hash)
+{
+  // NOTE: Files are registered with the disk manager by DiskCacheWriter once they've actually been written
+
+  SetFrameHash(dep, hash, job_time);
+
+  ResolveDuplicateFrames(hash);
+
   QList<rational> hashes_with_time = frame_cache()->FramesWithHash(hash);
 
   foreach (const rational& t, hashes_with_time) {
     emit CachedTimeReady(t, job_time);
   }
 
-  // Queue up a new frame for this worker
+  // Top up the job queue
   CacheNext();
 }
 
 void VideoRenderBackend::ThreadSkippedFrame(NodeDependency dep, qint64 job_time, QByteArray hash)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   if (SetFrameHash(dep, hash, job_time)
       && frame_cache_.HasHash(hash, params_.format())) {
     emit CachedTimeReady(dep.in(), job_time);
   }
 
-  // Queue up a new frame for this worker
+  // Top up the job queue
   CacheNext();
 }
 
 void VideoRenderBackend::ThreadHashAlreadyExists(NodeDependency dep, qint64 job_time, QByteArray hash)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   if (SetFrameHash(dep, hash, job_time)) {
     emit CachedTimeReady(dep.in(), job_time);
   }
 
-  // Queue up a new frame for this worker
+  QList<rational> duplicates = ResolveDuplicateFrames(hash);
+
+  foreach (const rational& t, duplicates) {
+    emit CachedTimeReady(t, job_time);
+  }
+
+  // Top up the job queue
   CacheNext();
 }
 
 void VideoRenderBackend::ThreadGeneratedFrame()
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   CacheNext();
 }
 
+void VideoRenderBackend::ThreadGeneratedHashes(NodeDependency dep, qint64 job_time, QVector<QByteArray> hashes)
+{
+  RenderWorker* worker = static_cast<RenderWorker*>(sender());
+
+  SetWorkerBusyState(worker, false);
+
+  hashing_frames_.RemoveTimeRange(dep.range());
+
+  // If the graph or parameters changed while this batch was running, its hashes may be out of date. They're ignored
+  // and the frames are hashed again once they're requeued below.
+  if (hash_batches_.take(worker)) {
+    rational t = dep.in();
+
+    foreach (const QByteArray& hash, hashes) {
+      TimeRange frame_range(t, t + params_.time_base());
+
+      hashed_frames_.InsertTimeRange(frame_range);
+
+      if (!(operating_mode_ & VideoRenderWorker::kRenderOnly)
+          || frame_cache_.HasHash(hash, params_.format())) {
+
+        // Nothing needs to be rendered for this frame
+        frame_cache_.SetHash(t, hash);
+
+        invalidated_.RemoveTimeRange(frame_range);
+
+        emit CachedTimeReady(t, job_time);
+
+      } else if (unique_frames_.contains(hash)) {
+
+        // Another frame with this hash is already queued, this one can wait for it rather than be rendered too
+        duplicate_frames_.insert(hash, t);
+
+      } else {
+
+        unique_frames_.insert(hash, t);
+        batch_hashes_.insert(t, hash);
+
+      }
+
+      t += params_.time_base();
+    }
+  }
+
+  // Put the frames that still need rendering back in the queue. Requeue() leaves out the ones that are done or waiting
+  // on a duplicate.
+  Requeue();
+}
+
 void VideoRenderBackend::TruncateFrameCacheLength(const rational &length)
 {
   // Remove frames after this time code if it's changed
@@ -325,6 +506,8 @@ void VideoRenderBackend::TruncateFrameCacheLength(const rational &length)
 
   invalidated_.RemoveTimeRange(TimeRange(length, RATIONAL_MAX));
 
+  ResetHashBatches();
+
   // If the playhead is past the length, update the viewer to a null texture because it won't be cached through the
   // queue, but will now be a null texture
   if (last_time_requested_ >= length) {
@@ -386,7 +569,270 @@ void VideoRenderBackend::Requeue()
 
   }
 
+  // Frames being hashed are requeued once their batch is done
+  foreach (const TimeRange& range, hashing_frames_) {
+    cache_queue_.RemoveTimeRange(range);
+  }
+
+  // Frames waiting on a duplicate don't need to be queued, unless that duplicate isn't going to be rendered anymore
+  QHash<QByteArray, rational>::iterator i = unique_frames_.begin();
+
+  while (i != unique_frames_.end()) {
+    TimeRange unique_frame(i.value(), i.value());
+
+    if (TimeIsQueued(unique_frame) || render_job_info_.contains(unique_frame)) {
+      foreach (const rational& t, duplicate_frames_.values(i.key())) {
+        cache_queue_.RemoveTimeRange(TimeRange(t, t + params_.time_base()));
+      }
+
+      i++;
+    } else {
+      duplicate_frames_.remove(i.key());
+      batch_hashes_.remove(i.value());
+      i = unique_frames_.erase(i);
+    }
+  }
+
+  UpdateQueueHeap();
+
   CacheNext();
 }
 
+void VideoRenderBackend::GetFrameTimestamps(const TimeRange &range, int64_t *first, int64_t *last) const
+{
+  const rational& timebase = params_.time_base();
+
+  *first = Timecode::time_to_timestamp(range.in(), timebase);
+  if (Timecode::timestamp_to_time(*first, timebase) > range.in()) {
+    (*first)--;
+  }
+
+  *last = Timecode::time_to_timestamp(range.out(), timebase);
+  if (Timecode::timestamp_to_time(*last, timebase) < range.out()) {
+    (*last)++;
+  }
+}
+
+int64_t VideoRenderBackend::GetPlayheadTimestamp() const
+{
+  int64_t playhead = Timecode::time_to_timestamp(last_time_requested_, params_.time_base());
+
+  if (Timecode::timestamp_to_time(playhead, params_.time_base()) > last_time_requested_) {
+    playhead--;
+  }
+
+  return playhead;
+}
+
+int64_t VideoRenderBackend::GetFramePriority(const int64_t &timestamp) const
+{
+  // While playing, frames the playhead has already passed are much less likely to be needed soon
+  int direction = (playback_speed_ < 0) ? -1 : 1;
+  int behind_weight = (playback_speed_ == 0) ? kPausedBehindWeight : kPlaybackBehindWeight;
+
+  int64_t distance = (timestamp - heap_playhead_) * direction;
+
+  if (distance < 0) {
+    distance = -distance * behind_weight;
+  }
+
+  return distance;
+}
+
+void VideoRenderBackend::RebuildQueueHeap()
+{
+  queue_heap_before_.clear();
+  queue_heap_after_.clear();
+  queued_frames_.clear();
+  heap_ranges_.clear();
+
+  if (!params_.is_valid()) {
+    return;
+  }
+
+  heap_playhead_ = GetPlayheadTimestamp();
+  heap_timebase_ = params_.time_base();
+
+  foreach (const TimeRange& range, cache_queue_) {
+    int64_t first, last;
+    GetFrameTimestamps(range, &first, &last);
+
+    for (int64_t ts=first; ts<last; ts++) {
+      if (!queued_frames_.contains(ts)) {
+        queued_frames_.insert(ts);
+
+        if (ts < heap_playhead_) {
+          queue_heap_before_.append(ts);
+        } else {
+          queue_heap_after_.append(ts);
+        }
+      }
+    }
+  }
+
+  std::make_heap(queue_heap_before_.begin(), queue_heap_before_.end());
+  std::make_heap(queue_heap_after_.begin(), queue_heap_after_.end(), std::greater<int64_t>());
+
+  heap_ranges_ = cache_queue_;
+}
+
+void VideoRenderBackend::UpdateQueueHeap()
+{
+  if (!params_.is_valid()) {
+    queue_heap_before_.clear();
+    queue_heap_after_.clear();
+    queued_frames_.clear();
+    heap_ranges_.clear();
+    return;
+  }
+
+  // Frames that left the queue are only dropped from the heaps when they reach the top, so once they outnumber the
+  // frames still queued it's cheaper to start over
+  if (heap_timebase_ != params_.time_base()
+      || queue_heap_before_.size() + queue_heap_after_.size() > 2 * queued_frames_.size()) {
+    RebuildQueueHeap();
+    return;
+  }
+
+  // Move the frames the playhead has passed over to the other heap, dropping any that are no longer queued
+  heap_playhead_ = GetPlayheadTimestamp();
+
+  while (!queue_heap_after_.isEmpty() && queue_heap_after_.first() < heap_playhead_) {
+    std::pop_heap(queue_heap_after_.begin(), queue_heap_after_.end(), std::greater<int64_t>());
+    int64_t ts = queue_heap_after_.takeLast();
+
+    if (queued_frames_.contains(ts)) {
+      PushQueueHeapFrame(ts);
+    }
+  }
+
+  while (!queue_heap_before_.isEmpty() && queue_heap_before_.first() >= heap_playhead_) {
+    std::pop_heap(queue_heap_before_.begin(), queue_heap_before_.end());
+    int64_t ts = queue_heap_before_.takeLast();
+
+    if (queued_frames_.contains(ts)) {
+      PushQueueHeapFrame(ts);
+    }
+  }
+
+  TimeRangeList removed = heap_ranges_;
+  TimeRangeList added = cache_queue_;
+
+  foreach (const TimeRange& range, cache_queue_) {
+    removed.RemoveTimeRange(range);
+  }
+
+  foreach (const TimeRange& range, heap_ranges_) {
+    added.RemoveTimeRange(range);
+  }
+
+  foreach (const TimeRange& range, removed) {
+    RemoveFramesFromQueueHeap(range);
+  }
+
+  foreach (const TimeRange& range, added) {
+    AddFramesToQueueHeap(range);
+  }
+
+  heap_ranges_ = cache_queue_;
+}
+
+void VideoRenderBackend::PushQueueHeapFrame(const int64_t &timestamp)
+{
+  if (timestamp < heap_playhead_) {
+    queue_heap_before_.append(timestamp);
+    std::push_heap(queue_heap_before_.begin(), queue_heap_before_.end());
+  } else {
+    queue_heap_after_.append(timestamp);
+    std::push_heap(queue_heap_after_.begin(), queue_heap_after_.end(), std::greater<int64_t>());
+  }
+}
+
+void VideoRenderBackend::AddFramesToQueueHeap(const TimeRange &range)
+{
+  int64_t first, last;
+  GetFrameTimestamps(range, &first, &last);
+
+  for (int64_t ts=first; ts<last; ts++) {
+    if (!queued_frames_.contains(ts)) {
+      queued_frames_.insert(ts);
+      PushQueueHeapFrame(ts);
+    }
+  }
+}
+
+void VideoRenderBackend::RemoveFramesFromQueueHeap(const TimeRange &range)
+{
+  // Only frames entirely inside the range have left the queue, a frame partially overlapping it may still be queued
+  int64_t first, last;
+  GetFrameTimestamps(range, &first, &last);
+
+  if (Timecode::timestamp_to_time(first, params_.time_base()) < range.in()) {
+    first++;
+  }
+
+  if (Timecode::timestamp_to_time(last, params_.time_base()) > range.out()) {
+    last--;
+  }
+
+  if (last - first > queued_frames_.size()) {
+    // Cheaper to go through the queued frames than every frame in the range
+    QSet<int64_t>::iterator i = queued_frames_.begin();
+
+    while (i != queued_frames_.end()) {
+      if (*i >= first && *i < last) {
+        i = queued_frames_.erase(i);
+      } else {
+        i++;
+      }
+    }
+  } else {
+    for (int64_t ts=first; ts<last; ts++) {
+      queued_frames_.remove(ts);
+    }
+  }
+}
+
+void VideoRenderBackend::RemoveTimeRangeFromQueue(const TimeRange &range)
+{
+  cache_queue_.RemoveTimeRange(range);
+  heap_ranges_.RemoveTimeRange(range);
+
+  RemoveFramesFromQueueHeap(range);
+}
+
+void VideoRenderBackend::ResetHashBatches()
+{
+  hashed_frames_.clear();
+  unique_frames_.clear();
+  duplicate_frames_.clear();
+  batch_hashes_.clear();
+
+  // Batches that are still running will have their hashes discarded
+  for (QHash<RenderWorker*, bool>::iterator i=hash_batches_.begin(); i!=hash_batches_.end(); i++) {
+    i.value() = false;
+  }
+}
+
+QList<rational> VideoRenderBackend::ResolveDuplicateFrames(const QByteArray &hash)
+{
+  QList<rational> duplicates = duplicate_frames_.values(hash);
+
+  duplicate_frames_.remove(hash);
+
+  QHash<QByteArray, rational>::iterator unique = unique_frames_.find(hash);
+  if (unique != unique_frames_.end()) {
+    batch_hashes_.remove(unique.value());
+    unique_frames_.erase(unique);
+  }
+
+  foreach (const rational& t, duplicates) {
+    frame_cache_.SetHash(t, hash);
+
+    invalidated_.RemoveTimeRange(TimeRange(t, t + params_.time_base()));
+  }
+
+  return duplicates;
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -21,7 +21,9 @@
 #ifndef VIDEORENDERERBACKEND_H
 #define VIDEORENDERERBACKEND_H
 
+#include <QHash>
 #include <QLinkedList>
+#include <QSet>
 
 #include "colorprocessorcache.h"
 #include "node/output/viewer/viewer.h"
@@ -66,10 +68,23 @@ public:
 
   void SetLimitCaching(bool limit);
 
-  QString GetCachedFrame(const rational& time);
+  /**
+   * @brief Returns the filename of the cached frame at this time
+   *
+   * If `memory_frame` is non-null, it's set to the frame if it's still held in memory, which is much faster to show
+   * than reading the file back from disk.
+   */
+  QString GetCachedFrame(const rational& time, FramePtr* memory_frame = nullptr);
 
   void UpdateLastRequestedTime(const rational& time);
 
+  /**
+   * @brief Set the speed the viewer is playing at (0 if paused, negative if playing in reverse)
+   *
+   * Frames in the direction of playback are prioritized over the frames the playhead has already passed.
+   */
+  void SetPlaybackSpeed(int speed);
+
   VideoRenderFrameCache* frame_cache();
 
   const VideoRenderingParams& params() const;
@@ -90,6 +105,10 @@ protected:
 
   virtual TimeRange PopNextFrameFromQueue() override;
 
+  virtual QByteArray TakeJobHash(const TimeRange& frame) override;
+
+  virtual bool DispatchQueueBatch(Node* node_connected_to_viewer) override;
+
   /**
    * @brief Internal function for generating the cache ID
    */
@@ -121,6 +140,77 @@ private:
 
   void Requeue();
 
+  /**
+   * @brief Get the timestamps of the first frame in this range and the frame after its last
+   */
+  void GetFrameTimestamps(const TimeRange& range, int64_t* first, int64_t* last) const;
+
+  /**
+   * @brief Get the timestamp of the frame the playhead is on
+   */
+  int64_t GetPlayheadTimestamp() const;
+
+  /**
+   * @brief Get how soon a frame should be cached relative to the playhead, lower is sooner
+   */
+  int64_t GetFramePriority(const int64_t& timestamp) const;
+
+  /**
+   * @brief Sort every frame in cache_queue_ into the heaps either side of the playhead
+   */
+  void RebuildQueueHeap();
+
+  /**
+   * @brief Bring the heaps up to date with cache_queue_ and the playhead
+   *
+   * Frames the playhead has moved past are moved to the other heap and frames that entered or left the queue are
+   * added or dropped. Nothing else needs to change since priorities are calculated from the playhead when popped.
+   */
+  void UpdateQueueHeap();
+
+  /**
+   * @brief Push a frame into the heap for its side of the playhead
+   */
+  void PushQueueHeapFrame(const int64_t& timestamp);
+
+  /**
+   * @brief Push any frames in this range that aren't in the heap yet
+   */
+  void AddFramesToQueueHeap(const TimeRange& range);
+
+  /**
+   * @brief Mark the frames entirely inside this range as no longer queued, they're dropped when popped from the heap
+   */
+  void RemoveFramesFromQueueHeap(const TimeRange& range);
+
+  /**
+   * @brief Remove a range from cache_queue_ and the heap
+   */
+  void RemoveTimeRangeFromQueue(const TimeRange& range);
+
+  /**
+   * @brief Discard all hashes generated by batches, e.g. because the graph or parameters have changed
+   */
+  void ResetHashBatches();
+
+  /**
+   * @brief Set the hash of all frames waiting on another frame with the same hash to be cached
+   *
+   * Returns the times of these frames.
+   */
+  QList<rational> ResolveDuplicateFrames(const QByteArray& hash);
+
+  /**
+   * @brief Maximum amount of frames hashed by a worker in one batch
+   */
+  static const int kMaxHashBatchSize;
+
+  /**
+   * @brief How much further away a frame behind the playhead is considered than one ahead of it
+   */
+  static const int kPausedBehindWeight;
+  static const int kPlaybackBehindWeight;
+
   VideoRenderingParams params_;
 
   VideoRenderFrameCache frame_cache_;
@@ -133,13 +223,73 @@ private:
 
   bool limit_caching_;
 
-  bool pop_toggle_;
+  int playback_speed_;
+
+  /**
+   * @brief Heaps of the frames in cache_queue_ before and after heap_playhead_
+   *
+   * Each heap has the frame closest to the playhead on top. Within one side of the playhead, frames are always in the
+   * same order whatever the playhead position or playback speed, so only the two tops need comparing to find the next
+   * frame. Frames that have since left the queue are skipped when popped.
+   */
+  QVector<int64_t> queue_heap_before_;
+  QVector<int64_t> queue_heap_after_;
+
+  /**
+   * @brief Timestamps of the frames in the heaps that are still queued
+   */
+  QSet<int64_t> queued_frames_;
+
+  /**
+   * @brief The ranges the heaps currently cover, used to find what's changed in cache_queue_ since
+   */
+  TimeRangeList heap_ranges_;
+
+  /**
+   * @brief Playhead the heaps are split at and the timebase of their timestamps
+   */
+  int64_t heap_playhead_;
+  rational heap_timebase_;
+
+  /**
+   * @brief Frames that have been hashed by a batch but still need to be cached
+   */
+  TimeRangeList hashed_frames_;
+
+  /**
+   * @brief Hashes found by batches that need caching, and the frame that's been queued to cache each one
+   */
+  QHash<QByteArray, rational> unique_frames_;
+
+  /**
+   * @brief Frames that have been taken out of the queue because another frame in unique_frames_ has the same hash
+   */
+  QMultiHash<QByteArray, rational> duplicate_frames_;
+
+  /**
+   * @brief Hashes batches found for the frames in unique_frames_, handed to the worker that renders each frame
+   */
+  QHash<rational, QByteArray> batch_hashes_;
+
+  /**
+   * @brief Frames being hashed by running batches
+   *
+   * These are kept out of cache_queue_ until their batch finishes so they aren't rendered (and hashed) at the same
+   * time.
+   */
+  TimeRangeList hashing_frames_;
+
+  /**
+   * @brief Workers currently hashing a batch, and whether that batch's hashes will still be valid when it finishes
+   */
+  QHash<RenderWorker*, bool> hash_batches_;
 
 private slots:
-  void ThreadCompletedDownload(NodeDependency dep, qint64 job_time, QByteArray hash, bool texture_existed);
+  void ThreadCompletedDownload(NodeDependency dep, qint64 job_time, QByteArray hash);
   void ThreadSkippedFrame(NodeDependency dep, qint64 job_time, QByteArray hash);
   void ThreadHashAlreadyExists(NodeDependency dep, qint64 job_time, QByteArray hash);
   void ThreadGeneratedFrame();
+  void ThreadGeneratedHashes(NodeDependency dep, qint64 job_time, QVector<QByteArray> hashes);
 
   void TruncateFrameCacheLength(const rational& length);
 
@@ -24,12 +24,19 @@
 #include <QFileInfo>
 
 #include "common/filefunctions.h"
+#include "config/config.h"
+#include "render/diskcachewriter.h"
+#include "render/diskmanager.h"
+#include "render/rawframefile.h"
 
 OLIVE_NAMESPACE_ENTER
 
+QAtomicInt VideoRenderFrameCache::cache_format_(kCacheFormatCompressed);
+
 void VideoRenderFrameCache::Clear()
 {
   time_hash_map_.clear();
+  hash_time_map_.clear();
 
   {
     QMutexLocker locker(&currently_caching_lock_);
@@ -41,7 +48,10 @@ void VideoRenderFrameCache::Clear()
 
 bool VideoRenderFrameCache::HasHash(const QByteArray &hash, const PixelFormat::Format& format)
 {
-  return QFileInfo::exists(CachePathName(hash, format)) && !IsCaching(hash);
+  return (DiskManager::instance()->IsFrameInMemory(hash)
+          || DiskCacheWriter::instance()->IsPending(hash)
+          || QFileInfo::exists(CachePathName(hash, format)))
+      && !IsCaching(hash);
 }
 
 bool VideoRenderFrameCache::IsCaching(const QByteArray &hash)
@@ -56,7 +66,7 @@ bool VideoRenderFrameCache::TryCache(const QByteArray &hash)
   QMutexLocker locker(&currently_caching_lock_);
 
   if (!currently_caching_list_.contains(hash)) {
-    currently_caching_list_.append(hash);
+    currently_caching_list_.insert(hash);
     return true;
   }
 
@@ -77,19 +87,29 @@ QByteArray VideoRenderFrameCache::TimeToHash(const rational &time) const
 
 void VideoRenderFrameCache::SetHash(const rational &time, const QByteArray &hash)
 {
-  time_hash_map_.insert(time, hash);
+  QMap<rational, QByteArray>::iterator existing = time_hash_map_.find(time);
+
+  if (existing != time_hash_map_.end()) {
+    if (existing.value() == hash) {
+      return;
+    }
+
+    RemoveTimeFromHash(existing.value(), time);
+    existing.value() = hash;
+  } else {
+    time_hash_map_.insert(time, hash);
+  }
+
+  hash_time_map_[hash].insert(time);
 }
 
 void VideoRenderFrameCache::Truncate(const rational &time)
 {
-  QMap<rational, QByteArray>::iterator i = time_hash_map_.begin();
+  QMap<rational, QByteArray>::iterator i = time_hash_map_.lowerBound(time);
 
   while (i != time_hash_map_.end()) {
-    if (i.key() >= time) {
-      i = time_hash_map_.erase(i);
-    } else {
-      i++;
-    }
+    RemoveTimeFromHash(i.value(), i.key());
+    i = time_hash_map_.erase(i);
   }
 }
 
@@ -97,41 +117,36 @@ void VideoRenderFrameCache::RemoveHashFromCurrentlyCaching(const QByteArray &has
 {
   QMutexLocker locker(&currently_caching_lock_);
 
-  currently_caching_list_.removeOne(hash);
+  currently_caching_list_.remove(hash);
 }
 
 QList<rational> VideoRenderFrameCache::FramesWithHash(const QByteArray &hash) const
 {
-  QList<rational> times;
+  return hash_time_map_.value(hash).toList();
+}
 
-  QMap<rational, QByteArray>::const_iterator iterator;
+QList<rational> VideoRenderFrameCache::TakeFramesWithHash(const QByteArray &hash)
+{
+  QList<rational> times = hash_time_map_.take(hash).toList();
 
-  for (iterator=time_hash_map_.begin();iterator!=time_hash_map_.end();iterator++) {
-    if (iterator.value() == hash) {
-      times.append(iterator.key());
-    }
+  foreach (const rational& t, times) {
+    time_hash_map_.remove(t);
   }
 
   return times;
 }
 
-QList<rational> VideoRenderFrameCache::TakeFramesWithHash(const QByteArray &hash)
+void VideoRenderFrameCache::RemoveTimeFromHash(const QByteArray &hash, const rational &time)
 {
-  QList<rational> times;
+  QHash< QByteArray, QSet<rational> >::iterator times = hash_time_map_.find(hash);
 
-  QMap<rational, QByteArray>::iterator iterator = time_hash_map_.begin();
+  if (times != hash_time_map_.end()) {
+    times.value().remove(time);
 
-  while (iterator != time_hash_map_.end()) {
-    if (iterator.value() == hash) {
-      times.append(iterator.key());
-
-      iterator = time_hash_map_.erase(iterator);
-    } else {
-      iterator++;
+    if (times.value().isEmpty()) {
+      hash_time_map_.erase(times);
     }
   }
-
-  return times;
 }
 
 const QMap<rational, QByteArray> &VideoRenderFrameCache::time_hash_map() const
@@ -143,7 +158,9 @@ QString VideoRenderFrameCache::CachePathName(const QByteArray& hash, const Pixel
 {
   QString ext;
 
-  if (pix_fmt == PixelFormat::PIX_FMT_RGB8
+  if (cache_format_.load() == kCacheFormatRaw) {
+    ext = RawFrameFile::kExtension;
+  } else if (pix_fmt == PixelFormat::PIX_FMT_RGB8
       || pix_fmt == PixelFormat::PIX_FMT_RGBA8
       || pix_fmt == PixelFormat::PIX_FMT_RGB16U
       || pix_fmt == PixelFormat::PIX_FMT_RGBA16U) {
@@ -160,4 +177,9 @@ QString VideoRenderFrameCache::CachePathName(const QByteArray& hash, const Pixel
   return cache_dir.filePath(filename);
 }
 
+void VideoRenderFrameCache::UpdateCacheFormat()
+{
+  cache_format_.store(Config::Current()["DiskCacheFormat"].toInt());
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -21,7 +21,10 @@
 #ifndef VIDEORENDERFRAMECACHE_H
 #define VIDEORENDERFRAMECACHE_H
 
+#include <QAtomicInt>
+#include <QHash>
 #include <QMutex>
+#include <QSet>
 
 #include "common/rational.h"
 #include "render/pixelformat.h"
@@ -31,6 +34,17 @@ OLIVE_NAMESPACE_ENTER
 class VideoRenderFrameCache
 {
 public:
+  /**
+   * @brief Formats that frames can be stored in on disk, set with the "DiskCacheFormat" config option
+   */
+  enum CacheFormat {
+    /// Lossy JPEG for integer pixel formats or DWAA-compressed EXR for float pixel formats (smallest files)
+    kCacheFormatCompressed,
+
+    /// Uncompressed lossless frames (fastest to write and read but largest files)
+    kCacheFormatRaw
+  };
+
   VideoRenderFrameCache() = default;
 
   void Clear();
@@ -55,6 +69,14 @@ public:
    */
   QString CachePathName(const QByteArray &hash, const PixelFormat::Format& pix_fmt) const;
 
+  /**
+   * @brief Update the format new frames are cached in from the "DiskCacheFormat" config value
+   *
+   * CachePathName() is called from render and writer threads, so rather than reading Config from those threads, the
+   * format is cached. This must be called from the main thread whenever that config value changes.
+   */
+  static void UpdateCacheFormat();
+
   void SetCacheID(const QString& id);
 
   QByteArray TimeToHash(const rational& time) const;
@@ -80,10 +102,22 @@ public:
 private:
   QMap<rational, QByteArray> time_hash_map_;
 
+  /**
+   * @brief Reverse of time_hash_map_ so frames using a hash can be found without scanning every frame
+   */
+  QHash< QByteArray, QSet<rational> > hash_time_map_;
+
+  /**
+   * @brief Remove one time from the frames using a hash, dropping the hash once nothing uses it
+   */
+  void RemoveTimeFromHash(const QByteArray& hash, const rational& time);
+
   QMutex currently_caching_lock_;
-  QVector<QByteArray> currently_caching_list_;
+  QSet<QByteArray> currently_caching_list_;
 
   QString cache_id_;
+
+  static QAtomicInt cache_format_;
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -20,20 +20,20 @@
 
 #include "videorenderworker.h"
 
-#include <OpenEXR/ImfFloatAttribute.h>
-#include <OpenEXR/ImfInputFile.h>
-#include <OpenEXR/ImfOutputFile.h>
-#include <OpenEXR/ImfChannelList.h>
-
 #include "common/define.h"
 #include "common/functiontimer.h"
 #include "node/block/transition/transition.h"
 #include "node/node.h"
 #include "project/project.h"
+#include "render/diskcachewriter.h"
+#include "render/diskmanager.h"
 #include "render/pixelformat.h"
 
 OLIVE_NAMESPACE_ENTER
 
+// Enough to download one frame while the previous one is still being written, like the old double-buffered download
+const int VideoRenderWorker::kMaxDownloadFrames = 2;
+
 VideoRenderWorker::VideoRenderWorker(VideoRenderFrameCache *frame_cache, QObject *parent) :
   RenderWorker(parent),
   frame_cache_(frame_cache),
@@ -56,27 +56,12 @@ void VideoRenderWorker::TextureToBuffer(const QVariant &texture, void *buffer, i
                   linesize);
 }
 
-NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, const qint64 &job_time)
+NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, const qint64 &job_time, const QByteArray &precomputed_hash)
 {
-  // Get hash of node graph
-  // We use SHA-1 for speed (benchmarks show it's the fastest hash available to us)
   QByteArray hash;
   if (operating_mode_ & kHashOnly) {
-    QCryptographicHash hasher(QCryptographicHash::Sha1);
-
-    // Embed video parameters into this hash
-    int vwidth = video_params_.effective_width();
-    int vheight = video_params_.effective_height();
-    PixelFormat::Format vfmt = video_params_.format();
-    RenderMode::Mode vmode = video_params_.mode();
-
-    hasher.addData(reinterpret_cast<const char*>(&vwidth), sizeof(int));
-    hasher.addData(reinterpret_cast<const char*>(&vheight), sizeof(int));
-    hasher.addData(reinterpret_cast<const char*>(&vfmt), sizeof(PixelFormat::Format));
-    hasher.addData(reinterpret_cast<const char*>(&vmode), sizeof(RenderMode::Mode));
-
-    HashNodeRecursively(&hasher, path.node(), path.in());
-    hash = hasher.result();
+    // Frames hashed in a batch already have their hash
+    hash = precomputed_hash.isEmpty() ? HashFrame(path.node(), path.in()) : precomputed_hash;
   }
 
   NodeValueTable value;
@@ -84,7 +69,7 @@ NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, con
   if (!(operating_mode_ & kRenderOnly)) {
 
     // Emit only the hash
-    emit CompletedDownload(path, job_time, hash, false);
+    emit CompletedDownload(path, job_time, hash);
 
   } else if ((operating_mode_ & kHashOnly) && frame_cache_->HasHash(hash, video_params_.format())) {
 
@@ -101,14 +86,14 @@ NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, con
 
     // If we actually have a texture, download it into the disk cache
     if (!texture.isNull() || (!(operating_mode_ & kDownloadOnly))) {
-      Download(path.in(), texture, frame_cache_->CachePathName(hash, video_params_.format()));
+      Download(path.in(), texture, hash);
     }
 
     frame_cache_->RemoveHashFromCurrentlyCaching(hash);
 
     // Signal that this job is complete
     if (operating_mode_ & kDownloadOnly) {
-      emit CompletedDownload(path, job_time, hash, !texture.isNull());
+      emit CompletedDownload(path, job_time, hash);
     }
 
   } else {
@@ -121,30 +106,98 @@ NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, con
   return value;
 }
 
+void VideoRenderWorker::Hash(NodeDependency dep, qint64 job_time)
+{
+  QVector<QByteArray> hashes;
+
+  for (rational t=dep.in(); t<dep.out(); t+=video_params_.time_base()) {
+    hashes.append(HashFrame(dep.node(), t));
+  }
+
+  emit HashesGenerated(dep, job_time, hashes);
+}
+
+QByteArray VideoRenderWorker::HashFrame(const Node *n, const rational &time)
+{
+  // Get hash of node graph
+  // We use SHA-1 for speed (benchmarks show it's the fastest hash available to us)
+  QCryptographicHash hasher(QCryptographicHash::Sha1);
+
+  // Embed video parameters into this hash
+  int vwidth = video_params_.effective_width();
+  int vheight = video_params_.effective_height();
+  PixelFormat::Format vfmt = video_params_.format();
+  RenderMode::Mode vmode = video_params_.mode();
+
+  hasher.addData(reinterpret_cast<const char*>(&vwidth), sizeof(int));
+  hasher.addData(reinterpret_cast<const char*>(&vheight), sizeof(int));
+  hasher.addData(reinterpret_cast<const char*>(&vfmt), sizeof(PixelFormat::Format));
+  hasher.addData(reinterpret_cast<const char*>(&vmode), sizeof(RenderMode::Mode));
+
+  HashNodeRecursively(&hasher, n, time);
+
+  return hasher.result();
+}
+
 void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node* n, const rational& time)
+{
+  bool time_invariant;
+
+  hash->addData(GetNodeHash(n, time, &time_invariant));
+}
+
+QByteArray VideoRenderWorker::GetNodeHash(const Node *n, const rational &time, bool *time_invariant)
 {
   // Resolve BlockList
   if (n->IsTrack()) {
+    // Which block is active depends on the time so a track can never be reused across frames
+    *time_invariant = false;
+
     n = static_cast<const TrackOutput*>(n)->BlockAtTime(time);
 
     if (!n) {
-      return;
+      return QByteArray();
     }
+
+    bool block_invariant;
+    return GetNodeHash(n, time, &block_invariant);
+  }
+
+  // If this node's hash didn't depend on the time, we'll already have it
+  QHash<const Node*, QByteArray>::const_iterator cached = node_hash_cache_.constFind(n);
+  if (cached != node_hash_cache_.constEnd()) {
+    *time_invariant = true;
+    return cached.value();
   }
 
+  // Each node's hash is made from its own values and the hashes of the nodes connected to it, so any part of the graph
+  // that doesn't change over time only needs to be hashed once
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+
+  *time_invariant = true;
+
   // Add this Node's ID
-  hash->addData(n->id().toUtf8());
+  hash.addData(n->id().toUtf8());
+
+  if (n->OutputDependsOnTime()) {
+    *time_invariant = false;
+
+    double time_dbl = time.toDouble();
+    hash.addData(reinterpret_cast<const char*>(&time_dbl), sizeof(double));
+  }
 
   if (n->IsBlock() && static_cast<const Block*>(n)->type() == Block::kTransition) {
     const TransitionBlock* transition = static_cast<const TransitionBlock*>(n);
 
+    *time_invariant = false;
+
     double all_prog = transition->GetTotalProgress(time);
     double in_prog = transition->GetInProgress(time);
     double out_prog = transition->GetOutProgress(time);
 
-    hash->addData(reinterpret_cast<const char*>(&all_prog), sizeof(double));
-    hash->addData(reinterpret_cast<const char*>(&in_prog), sizeof(double));
-    hash->addData(reinterpret_cast<const char*>(&out_prog), sizeof(double));
+    hash.addData(reinterpret_cast<const char*>(&all_prog), sizeof(double));
+    hash.addData(reinterpret_cast<const char*>(&in_prog), sizeof(double));
+    hash.addData(reinterpret_cast<const char*>(&out_prog), sizeof(double));
   }
 
   foreach (NodeParam* param, n->parameters()) {
@@ -169,11 +222,21 @@ void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node
 
       if (input->IsConnected()) {
         // Traverse down this edge
-        HashNodeRecursively(hash, input->get_connected_node(), input_time);
+        bool input_invariant;
+
+        hash.addData(GetNodeHash(input->get_connected_node(), input_time, &input_invariant));
+
+        if (!input_invariant) {
+          *time_invariant = false;
+        }
       } else {
         // Grab the value at this time
         QVariant value = input->get_value_at_time(input_time);
-        hash->addData(NodeParam::ValueToBytes(input->data_type(), value));
+        hash.addData(NodeParam::ValueToBytes(input->data_type(), value));
+
+        if (input->is_keyframing()) {
+          *time_invariant = false;
+        }
       }
 
       // We have one exception for FOOTAGE types, since we resolve the footage into a frame in the renderer
@@ -188,31 +251,33 @@ void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node
             // Add footage details to hash
 
             // Footage filename
-            hash->addData(stream->footage()->filename().toUtf8());
+            hash.addData(stream->footage()->filename().toUtf8());
 
             // Footage last modified date
-            hash->addData(stream->footage()->timestamp().toString().toUtf8());
+            hash.addData(stream->footage()->timestamp().toString().toUtf8());
 
             // Footage stream
-            hash->addData(QString::number(stream->index()).toUtf8());
+            hash.addData(QString::number(stream->index()).toUtf8());
 
             if (stream->type() == Stream::kImage || stream->type() == Stream::kVideo) {
               ImageStreamPtr image_stream = std::static_pointer_cast<ImageStream>(stream);
 
               // Current color config and space
-              hash->addData(image_stream->footage()->project()->color_manager()->GetConfigFilename().toUtf8());
-              hash->addData(image_stream->colorspace().toUtf8());
+              hash.addData(image_stream->footage()->project()->color_manager()->GetConfigFilename().toUtf8());
+              hash.addData(image_stream->colorspace().toUtf8());
 
               // Alpha associated setting
-              hash->addData(QString::number(image_stream->premultiplied_alpha()).toUtf8());
+              hash.addData(QString::number(image_stream->premultiplied_alpha()).toUtf8());
             }
 
             // Footage timestamp
             if (stream->type() == Stream::kVideo) {
-              hash->addData(QStringLiteral("%1/%2").arg(QString::number(input_time.numerator()),
-                                                        QString::number(input_time.denominator())).toUtf8());
+              *time_invariant = false;
+
+              hash.addData(QStringLiteral("%1/%2").arg(QString::number(input_time.numerator()),
+                                                       QString::number(input_time.denominator())).toUtf8());
 
-              hash->addData(QString::number(static_cast<VideoStream*>(stream.get())->start_time()).toUtf8());
+              hash.addData(QString::number(static_cast<VideoStream*>(stream.get())->start_time()).toUtf8());
               /*Decoder::RetrieveState state = decoder->GetRetrieveState(input_time);
 
               if (state == Decoder::kReady) {
@@ -220,7 +285,7 @@ void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node
 
                 int64_t timestamp_here = video_stream->get_closest_timestamp_in_frame_index(input_time);
 
-                hash->addData(QString::number(timestamp_here).toUtf8());
+                hash.addData(QString::number(timestamp_here).toUtf8());
               } else {
                 ReportUnavailableFootage(stream, state, input_time);
               }*/
@@ -230,16 +295,44 @@ void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node
       }
     }
   }
+
+  QByteArray result = hash.result();
+
+  if (*time_invariant) {
+    node_hash_cache_.insert(n, result);
+  }
+
+  return result;
 }
 
-void VideoRenderWorker::SetParameters(const VideoRenderingParams &video_params)
+FramePtr VideoRenderWorker::GetDownloadFrame()
 {
-  video_params_ = video_params;
+  // If we hold the only reference to a frame, the memory cache has evicted it and the disk writer is done with it
+  foreach (const FramePtr& f, download_frames_) {
+    if (f.use_count() == 1) {
+      return f;
+    }
+  }
+
+  FramePtr f = Frame::Create();
 
-  if (IsStarted()) {
-    ResizeDownloadBuffer();
+  if (download_frames_.size() < kMaxDownloadFrames) {
+    download_frames_.append(f);
   }
 
+  return f;
+}
+
+void VideoRenderWorker::GraphChangedEvent()
+{
+  // Any cached hash may now be out of date
+  node_hash_cache_.clear();
+}
+
+void VideoRenderWorker::SetParameters(const VideoRenderingParams &video_params)
+{
+  video_params_ = video_params;
+
   ParametersChangedEvent();
 }
 
@@ -261,101 +354,33 @@ void VideoRenderWorker::SetFrameGenerationParams(int width, int height, const QM
 
 bool VideoRenderWorker::InitInternal()
 {
-  ResizeDownloadBuffer();
   return true;
 }
 
 void VideoRenderWorker::CloseInternal()
 {
-  download_buffer_.clear();
+  download_frames_.clear();
 }
 
-void VideoRenderWorker::Download(const rational& time, QVariant texture, QString filename)
+void VideoRenderWorker::Download(const rational& time, QVariant texture, const QByteArray &hash)
 {
   if (operating_mode_ & kDownloadOnly) {
 
-    TextureToBuffer(texture, download_buffer_.data(), 0);
-
-    switch (video_params().format()) {
-    case PixelFormat::PIX_FMT_RGB8:
-    case PixelFormat::PIX_FMT_RGBA8:
-    case PixelFormat::PIX_FMT_RGB16U:
-    case PixelFormat::PIX_FMT_RGBA16U:
-    {
-      // Integer types are stored in JPEG which we run through OIIO
-
-      std::string fn_std = filename.toStdString();
-
-      auto out = OIIO::ImageOutput::create(fn_std);
-
-      if (out) {
-        // Attempt to keep this write to one thread
-        out->threads(1);
-
-        out->open(fn_std, OIIO::ImageSpec(video_params().effective_width(),
-                                          video_params().effective_height(),
-                                          PixelFormat::ChannelCount(video_params().format()),
-                                          PixelFormat::GetOIIOTypeDesc(video_params().format())));
-
-        out->write_image(PixelFormat::GetOIIOTypeDesc(video_params().format()), download_buffer_.data());
-
-        out->close();
-
-#if OIIO_VERSION < 10903
-        OIIO::ImageOutput::destroy(out);
-#endif
-      } else {
-        qCritical() << "Failed to write JPEG file:" << OIIO::geterror().c_str();
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGB16F:
-    case PixelFormat::PIX_FMT_RGBA16F:
-    case PixelFormat::PIX_FMT_RGB32F:
-    case PixelFormat::PIX_FMT_RGBA32F:
-    {
-      // Floating point types are stored in EXR
-      Imf::PixelType pix_type;
-
-      if (video_params().format() == PixelFormat::PIX_FMT_RGB16F
-          || video_params().format() == PixelFormat::PIX_FMT_RGBA16F) {
-        pix_type = Imf::HALF;
-      } else {
-        pix_type = Imf::FLOAT;
-      }
-
-      Imf::Header header(video_params().effective_width(),
-                         video_params().effective_height());
-      header.channels().insert("R", Imf::Channel(pix_type));
-      header.channels().insert("G", Imf::Channel(pix_type));
-      header.channels().insert("B", Imf::Channel(pix_type));
-      header.channels().insert("A", Imf::Channel(pix_type));
-
-      header.compression() = Imf::DWAA_COMPRESSION;
-      header.insert("dwaCompressionLevel", Imf::FloatAttribute(200.0f));
-
-      Imf::OutputFile out(filename.toUtf8(), header, 0);
-
-      int bpc = PixelFormat::BytesPerChannel(video_params().format());
+    FramePtr frame = GetDownloadFrame();
+    frame->set_video_params(VideoRenderingParams(video_params_.effective_width(),
+                                                 video_params_.effective_height(),
+                                                 video_params_.format()));
+    frame->allocate();
 
-      size_t xs = kRGBAChannels * bpc;
-      size_t ys = video_params().effective_width() * kRGBAChannels * bpc;
+    TextureToBuffer(texture, frame->data(), frame->linesize_pixels());
 
-      Imf::FrameBuffer framebuffer;
-      framebuffer.insert("R", Imf::Slice(pix_type, download_buffer_.data(), xs, ys));
-      framebuffer.insert("G", Imf::Slice(pix_type, download_buffer_.data() + bpc, xs, ys));
-      framebuffer.insert("B", Imf::Slice(pix_type, download_buffer_.data() + 2*bpc, xs, ys));
-      framebuffer.insert("A", Imf::Slice(pix_type, download_buffer_.data() + 3*bpc, xs, ys));
-      out.setFrameBuffer(framebuffer);
+    // Compress and write on the disk cache writer's threads so we can move on to the next frame. This is queued before
+    // the frame goes into the memory cache so that, even if it's evicted straight away, the writer holds it until the
+    // file is complete.
+    DiskCacheWriter::instance()->Queue(hash, frame_cache_->CachePathName(hash, video_params_.format()), frame);
 
-      out.writePixels(video_params().effective_height());
-      break;
-    }
-    case PixelFormat::PIX_FMT_INVALID:
-    case PixelFormat::PIX_FMT_COUNT:
-      qCritical() << "Unable to cache invalid pixel format" << video_params().format();
-      break;
-    }
+    // Keep the frame in memory so the viewer can show it without reading it back from disk
+    DiskManager::instance()->AddFrameToMemory(hash, frame);
 
   } else {
 
@@ -382,11 +407,6 @@ void VideoRenderWorker::Download(const rational& time, QVariant texture, QString
   }
 }
 
-void VideoRenderWorker::ResizeDownloadBuffer()
-{
-  download_buffer_.resize(PixelFormat::GetBufferSize(video_params_.format(), video_params_.effective_width(), video_params_.effective_height()));
-}
-
 NodeValueTable VideoRenderWorker::RenderBlock(const TrackOutput *track, const TimeRange &range)
 {
   // A frame can only have one active block so we just validate the in point of the range
@@ -23,6 +23,7 @@
 
 #include <QCryptographicHash>
 #include <QMatrix4x4>
+#include <QVector>
 
 #include "colorprocessorcache.h"
 #include "node/dependency.h"
@@ -72,8 +73,16 @@ public:
 
   void SetFrameGenerationParams(int width, int height, const QMatrix4x4 &matrix);
 
+public slots:
+  /**
+   * @brief Generate the hash of every frame in a range without rendering any of them
+   *
+   * Hashes are generated for each frame from `dep.in()` up to `dep.out()` and sent in order in HashesGenerated().
+   */
+  void Hash(OLIVE_NAMESPACE::NodeDependency dep, qint64 job_time);
+
 signals:
-  void CompletedDownload(NodeDependency path, qint64 job_time, QByteArray hash, bool texture_existed);
+  void CompletedDownload(NodeDependency path, qint64 job_time, QByteArray hash);
 
   void HashAlreadyBeingCached(NodeDependency path, qint64 job_time, QByteArray hash);
 
@@ -81,6 +90,8 @@ signals:
 
   void GeneratedFrame(const rational &time, FramePtr frame);
 
+  void HashesGenerated(NodeDependency path, qint64 job_time, QVector<QByteArray> hashes);
+
   void Aborted();
 
 protected:
@@ -96,20 +107,39 @@ protected:
 
   virtual void TextureToBuffer(const QVariant& texture, int width, int height, const QMatrix4x4& matrix, void *buffer, int linesize) = 0;
 
-  virtual NodeValueTable RenderInternal(const NodeDependency& CurrentPath, const qint64& job_time) override;
+  virtual NodeValueTable RenderInternal(const NodeDependency& CurrentPath, const qint64& job_time, const QByteArray& hash) override;
 
   virtual NodeValueTable RenderBlock(const TrackOutput *track, const TimeRange& range) override;
 
   virtual void ReportUnavailableFootage(StreamPtr stream, Decoder::RetrieveState state, const rational& stream_time) override;
 
+  virtual void GraphChangedEvent() override;
+
   ColorProcessorCache* color_cache();
 
 private:
+  QByteArray HashFrame(const Node* n, const rational& time);
+
   void HashNodeRecursively(QCryptographicHash* hash, const Node *n, const rational &time);
 
-  void Download(const rational &time, QVariant texture, QString filename);
+  /**
+   * @brief Returns the hash of a node and everything connected to it at a given time
+   *
+   * `time_invariant` is set to whether this hash is the same at every time. Those hashes are cached in
+   * node_hash_cache_ until the graph changes.
+   */
+  QByteArray GetNodeHash(const Node *n, const rational &time, bool* time_invariant);
+
+  void Download(const rational &time, QVariant texture, const QByteArray &hash);
+
+  /**
+   * @brief Get a frame to download into, reusing a previous one once the memory cache and disk writer release it
+   */
+  FramePtr GetDownloadFrame();
+
+  QList<FramePtr> download_frames_;
 
-  void ResizeDownloadBuffer();
+  static const int kMaxDownloadFrames;
 
   VideoRenderingParams frame_gen_params_;
 
@@ -121,7 +151,7 @@ private:
 
   ColorProcessorCache color_cache_;
 
-  QByteArray download_buffer_;
+  QHash<const Node*, QByteArray> node_hash_cache_;
 
   OperatingMode operating_mode_;
 
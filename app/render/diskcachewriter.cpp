@@ -0,0 +1,311 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "diskcachewriter.h"
+
+#include <OpenEXR/ImfChannelList.h>
+#include <OpenEXR/ImfFloatAttribute.h>
+#include <OpenEXR/ImfOutputFile.h>
+#include <OpenImageIO/imageio.h>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThread>
+
+#include "render/diskmanager.h"
+#include "render/pixelformat.h"
+#include "render/rawframefile.h"
+
+OLIVE_NAMESPACE_ENTER
+
+DiskCacheWriter* DiskCacheWriter::instance_ = nullptr;
+
+class DiskCacheWriter::WriteTask : public QRunnable
+{
+public:
+  WriteTask(DiskCacheWriter* parent, const QByteArray& hash, const QString& filename, FramePtr frame) :
+    parent_(parent),
+    hash_(hash),
+    filename_(filename),
+    frame_(frame)
+  {
+  }
+
+  virtual void run() override
+  {
+    parent_->FrameWritten(hash_, filename_, DiskCacheWriter::WriteFrame(filename_, frame_));
+  }
+
+private:
+  DiskCacheWriter* parent_;
+
+  QByteArray hash_;
+
+  QString filename_;
+
+  FramePtr frame_;
+
+};
+
+DiskCacheWriter::DiskCacheWriter()
+{
+  // Leave the rest of the cores for the render workers and decoders
+  pool_.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+
+  // Allow a few frames per writer thread to be queued before render workers have to wait
+  max_pending_ = pool_.maxThreadCount() * 4;
+}
+
+DiskCacheWriter::~DiskCacheWriter()
+{
+  WaitForFinished();
+}
+
+void DiskCacheWriter::CreateInstance()
+{
+  instance_ = new DiskCacheWriter();
+}
+
+void DiskCacheWriter::DestroyInstance()
+{
+  delete instance_;
+  instance_ = nullptr;
+}
+
+DiskCacheWriter *DiskCacheWriter::instance()
+{
+  return instance_;
+}
+
+void DiskCacheWriter::Queue(const QByteArray &hash, const QString &filename, FramePtr frame)
+{
+  int depth;
+
+  {
+    QMutexLocker locker(&lock_);
+
+    if (pending_.contains(hash, filename)) {
+      // This exact file is already being written with the same contents, writing it again at the same time would only
+      // have two threads fighting over the same file
+      return;
+    }
+
+    while (pending_.size() >= max_pending_) {
+      space_available_.wait(&lock_);
+    }
+
+    pending_.insert(hash, filename);
+    pending_frames_.insert(hash, frame);
+
+    depth = pending_.size();
+  }
+
+  pool_.start(new WriteTask(this, hash, filename, frame));
+
+  emit QueueDepthChanged(depth);
+}
+
+bool DiskCacheWriter::IsPending(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  return pending_.contains(hash);
+}
+
+FramePtr DiskCacheWriter::GetPendingFrame(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  return pending_frames_.value(hash);
+}
+
+int DiskCacheWriter::GetQueueDepth()
+{
+  QMutexLocker locker(&lock_);
+
+  return pending_.size();
+}
+
+void DiskCacheWriter::WaitForFinished()
+{
+  pool_.waitForDone();
+}
+
+bool DiskCacheWriter::WriteFrame(const QString &filename, FramePtr frame)
+{
+  if (filename.endsWith(RawFrameFile::kExtension)) {
+    return RawFrameFile::Write(filename, frame);
+  }
+
+  // The viewer, decoders and the disk manager may open the cache file at any time, so it's written under a working
+  // name and only moved into place once it's complete. The extension is kept so OIIO still picks the right format.
+  QFileInfo info(filename);
+  QString working_filename = info.dir().filePath(QStringLiteral("%1.working.%2").arg(info.completeBaseName(),
+                                                                                     info.suffix()));
+
+  if (!EncodeFrame(working_filename, frame)) {
+    QFile::remove(working_filename);
+    return false;
+  }
+
+  // Replace any older copy of this frame
+  QFile::remove(filename);
+
+  if (!QFile::rename(working_filename, filename)) {
+    qCritical() << "Failed to move cache file into place:" << filename;
+    QFile::remove(working_filename);
+    return false;
+  }
+
+  return true;
+}
+
+bool DiskCacheWriter::EncodeFrame(const QString &filename, FramePtr frame)
+{
+  switch (frame->format()) {
+  case PixelFormat::PIX_FMT_RGB8:
+  case PixelFormat::PIX_FMT_RGBA8:
+  case PixelFormat::PIX_FMT_RGB16U:
+  case PixelFormat::PIX_FMT_RGBA16U:
+  {
+    // Integer types are stored in JPEG which we run through OIIO
+
+    std::string fn_std = filename.toStdString();
+
+    auto out = OIIO::ImageOutput::create(fn_std);
+
+    if (!out) {
+      qCritical() << "Failed to write JPEG file:" << OIIO::geterror().c_str();
+      return false;
+    }
+
+    // Attempt to keep this write to one thread, we already run several writes in parallel
+    out->threads(1);
+
+    bool success = out->open(fn_std, OIIO::ImageSpec(frame->width(),
+                                                     frame->height(),
+                                                     PixelFormat::ChannelCount(frame->format()),
+                                                     PixelFormat::GetOIIOTypeDesc(frame->format())))
+        && out->write_image(PixelFormat::GetOIIOTypeDesc(frame->format()),
+                            frame->const_data(),
+                            OIIO::AutoStride,
+                            frame->linesize_bytes())
+        && out->close();
+
+    if (!success) {
+      qCritical() << "Failed to write JPEG file:" << filename << out->geterror().c_str();
+    }
+
+#if OIIO_VERSION < 10903
+    OIIO::ImageOutput::destroy(out);
+#endif
+
+    return success;
+  }
+  case PixelFormat::PIX_FMT_RGB16F:
+  case PixelFormat::PIX_FMT_RGBA16F:
+  case PixelFormat::PIX_FMT_RGB32F:
+  case PixelFormat::PIX_FMT_RGBA32F:
+  {
+    // Floating point types are stored in EXR
+    Imf::PixelType pix_type;
+
+    if (frame->format() == PixelFormat::PIX_FMT_RGB16F
+        || frame->format() == PixelFormat::PIX_FMT_RGBA16F) {
+      pix_type = Imf::HALF;
+    } else {
+      pix_type = Imf::FLOAT;
+    }
+
+    try {
+      Imf::Header header(frame->width(), frame->height());
+      header.channels().insert("R", Imf::Channel(pix_type));
+      header.channels().insert("G", Imf::Channel(pix_type));
+      header.channels().insert("B", Imf::Channel(pix_type));
+      header.channels().insert("A", Imf::Channel(pix_type));
+
+      header.compression() = Imf::DWAA_COMPRESSION;
+      header.insert("dwaCompressionLevel", Imf::FloatAttribute(200.0f));
+
+      Imf::OutputFile out(filename.toUtf8(), header, 0);
+
+      int bpc = PixelFormat::BytesPerChannel(frame->format());
+
+      size_t xs = kRGBAChannels * bpc;
+      size_t ys = frame->linesize_bytes();
+
+      // The frame may be shared with the memory cache and the viewer so we must not detach it with data(). Imf::Slice
+      // only takes a non-const pointer but the data is only read while writing.
+      char* data = const_cast<char*>(frame->const_data());
+
+      Imf::FrameBuffer framebuffer;
+      framebuffer.insert("R", Imf::Slice(pix_type, data, xs, ys));
+      framebuffer.insert("G", Imf::Slice(pix_type, data + bpc, xs, ys));
+      framebuffer.insert("B", Imf::Slice(pix_type, data + 2*bpc, xs, ys));
+      framebuffer.insert("A", Imf::Slice(pix_type, data + 3*bpc, xs, ys));
+      out.setFrameBuffer(framebuffer);
+
+      out.writePixels(frame->height());
+
+      return true;
+    } catch (const std::exception& e) {
+      // OpenEXR reports errors by throwing, which would take down the whole application from a pool thread
+      qCritical() << "Failed to write EXR file:" << filename << e.what();
+      return false;
+    }
+  }
+  case PixelFormat::PIX_FMT_INVALID:
+  case PixelFormat::PIX_FMT_COUNT:
+    break;
+  }
+
+  qCritical() << "Unable to cache invalid pixel format" << frame->format();
+  return false;
+}
+
+void DiskCacheWriter::FrameWritten(const QByteArray &hash, const QString &filename, bool success)
+{
+  // Register the file with the disk manager now that it actually exists
+  if (success) {
+    DiskManager::instance()->CreatedFile(filename, hash);
+  }
+
+  int depth;
+
+  {
+    QMutexLocker locker(&lock_);
+
+    pending_.remove(hash, filename);
+
+    if (!pending_.contains(hash)) {
+      pending_frames_.remove(hash);
+    }
+
+    depth = pending_.size();
+
+    space_available_.wakeAll();
+  }
+
+  emit QueueDepthChanged(depth);
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,128 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DISKCACHEWRITER_H
+#define DISKCACHEWRITER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "codec/frame.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Compresses and writes rendered frames to the disk cache on its own pool of threads
+ *
+ * Render workers hand their downloaded frames to this class and move straight on to their next job rather than
+ * spending CPU time compressing and writing files while their GPU context sits idle.
+ *
+ * The queue is bounded so that workers block (rather than holding an unlimited number of frames in memory) if they
+ * render faster than frames can be written.
+ */
+class DiskCacheWriter : public QObject
+{
+  Q_OBJECT
+public:
+  static void CreateInstance();
+
+  static void DestroyInstance();
+
+  static DiskCacheWriter* instance();
+
+  /**
+   * @brief Queue a frame to be written to `filename`
+   *
+   * Once the file is written, it's registered with DiskManager under `hash`. Blocks if the queue is full.
+   */
+  void Queue(const QByteArray& hash, const QString& filename, FramePtr frame);
+
+  /**
+   * @brief Returns whether a frame with this hash is queued or currently being written
+   */
+  bool IsPending(const QByteArray& hash);
+
+  /**
+   * @brief Returns the frame being written under this hash, or nullptr if there isn't one
+   *
+   * Until a write has finished, its file may be incomplete or not exist at all, so anything that wants to show a
+   * pending frame should use this rather than reading the file.
+   */
+  FramePtr GetPendingFrame(const QByteArray& hash);
+
+  /**
+   * @brief Returns the number of frames queued or currently being written
+   */
+  int GetQueueDepth();
+
+  /**
+   * @brief Blocks until all queued frames have been written
+   */
+  void WaitForFinished();
+
+signals:
+  void QueueDepthChanged(int depth);
+
+private:
+  DiskCacheWriter();
+
+  virtual ~DiskCacheWriter() override;
+
+  static DiskCacheWriter* instance_;
+
+  /**
+   * @brief Write a frame to a working file and move it to `filename` once it's complete
+   */
+  static bool WriteFrame(const QString& filename, FramePtr frame);
+
+  static bool EncodeFrame(const QString& filename, FramePtr frame);
+
+  void FrameWritten(const QByteArray& hash, const QString& filename, bool success);
+
+  class WriteTask;
+
+  QThreadPool pool_;
+
+  /**
+   * @brief Files queued or currently being written, by the hash they'll be registered under
+   *
+   * A hash may have more than one file pending (e.g. the same frame cached in different formats).
+   */
+  QMultiHash<QByteArray, QString> pending_;
+
+  /**
+   * @brief Frames being written, kept alive until every file pending under their hash has been written
+   */
+  QHash<QByteArray, FramePtr> pending_frames_;
+
+  int max_pending_;
+
+  QMutex lock_;
+
+  QWaitCondition space_available_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // DISKCACHEWRITER_H
@@ -20,12 +20,15 @@
 
 #include "diskmanager.h"
 
+#include <QCoreApplication>
 #include <QDataStream>
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QStandardPaths>
+#include <QThread>
 
 #include "common/filefunctions.h"
 #include "config/config.h"
@@ -35,7 +38,11 @@ OLIVE_NAMESPACE_ENTER
 DiskManager* DiskManager::instance_ = nullptr;
 
 DiskManager::DiskManager() :
-  consumption_(0)
+  lru_head_(nullptr),
+  lru_tail_(nullptr),
+  journal_record_count_(0),
+  consumption_(0),
+  memory_consumption_(0)
 {
   // Try to load any current cache index from file
   QFile cache_index_file(GetCacheIndexFilename());
@@ -43,44 +50,55 @@ DiskManager::DiskManager() :
   if (cache_index_file.open(QFile::ReadOnly)) {
     QDataStream ds(&cache_index_file);
 
+    // The index is stored in least-recently-used order so appending each entry restores the same order
     while (!cache_index_file.atEnd()) {
-      HashTime h;
-
-      ds >> h.file_name;
-      ds >> h.hash;
-      ds >> h.access_time;
-      ds >> h.file_size;
-
-      if (QFileInfo::exists(h.file_name)) {
-        consumption_ += h.file_size;
-        disk_data_.append(h);
+      QString file_name;
+      QByteArray hash;
+      qint64 access_time;
+      qint64 file_size;
+
+      ds >> file_name;
+      ds >> hash;
+      ds >> access_time;
+      ds >> file_size;
+
+      if (ds.status() != QDataStream::Ok) {
+        break;
       }
+
+      // We don't check whether each file still exists here since that makes startup scale with the size of the
+      // cache. Entries whose files have gone missing are harmless and will be evicted like any other.
+      AddEntry(file_name, hash, access_time, file_size);
     }
   }
+
+  // Replay any changes that were made after the index was last written. If a compaction was interrupted, its journal
+  // will still exist and must be replayed before the current one.
+  LoadJournal(GetCompactingJournalFilename());
+  LoadJournal(GetCacheJournalFilename());
+
+  pending_accesses_.clear();
+
+  OpenJournal();
 }
 
 DiskManager::~DiskManager()
 {
+  // Register any files that were written just before we were destroyed
+  QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+
   if (Config::Current()["ClearDiskCacheOnClose"].toBool()) {
     // Clear all cache data
     ClearDiskCache(true);
-  } else {
-    // Save current cache index
-    QFile cache_index_file(GetCacheIndexFilename());
+  }
 
-    if (cache_index_file.open(QFile::WriteOnly)) {
-      QDataStream ds(&cache_index_file);
+  // Write the full index so the journal doesn't need to be replayed next time
+  FlushPendingAccesses();
+  CompactIfNecessary(true);
 
-      foreach (const HashTime& h, disk_data_) {
-        ds << h.file_name;
-        ds << h.hash;
-        ds << h.access_time;
-        ds << h.file_size;
-      }
-    } else {
-      qWarning() << "Failed to write cache index:" << GetCacheIndexFilename();
-    }
-  }
+  journal_.close();
+
+  ClearEntries();
 }
 
 void DiskManager::CreateInstance()
@@ -101,62 +119,62 @@ DiskManager *DiskManager::instance()
 
 void DiskManager::Accessed(const QByteArray &hash)
 {
-  lock_.lock();
+  QMutexLocker locker(&lock_);
 
-  for (int i=disk_data_.size()-1;i>=0;i--) {
-    const HashTime& h = disk_data_.at(i);
+  // Touch every file cached under this hash
+  QMultiHash<QByteArray, HashTime*>::const_iterator i = hash_map_.constFind(hash);
 
-    if (h.hash == hash) {
-      HashTime moved_hash = h;
-
-      moved_hash.access_time = QDateTime::currentMSecsSinceEpoch();
-
-      disk_data_.removeAt(i);
-      disk_data_.append(moved_hash);
-      break;
-    }
+  while (i != hash_map_.constEnd() && i.key() == hash) {
+    Touch(i.value());
+    i++;
   }
-
-  lock_.unlock();
 }
 
 void DiskManager::Accessed(const QString &filename)
 {
-  lock_.lock();
-
-  for (int i=disk_data_.size()-1;i>=0;i--) {
-    const HashTime& h = disk_data_.at(i);
+  QMutexLocker locker(&lock_);
 
-    if (h.file_name == filename) {
-      HashTime moved_hash = h;
+  HashTime* h = filename_map_.value(filename);
 
-      moved_hash.access_time = QDateTime::currentMSecsSinceEpoch();
-
-      disk_data_.removeAt(i);
-      disk_data_.append(moved_hash);
-      break;
-    }
+  if (h) {
+    Touch(h);
   }
-
-  lock_.unlock();
 }
 
 void DiskManager::CreatedFile(const QString &file_name, const QByteArray &hash)
 {
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(this,
+                              "CreatedFile",
+                              Qt::QueuedConnection,
+                              Q_ARG(QString, file_name),
+                              Q_ARG(QByteArray, hash));
+    return;
+  }
+
   lock_.lock();
 
   qint64 file_size = QFile(file_name).size();
 
-  disk_data_.append({file_name, hash, QDateTime::currentMSecsSinceEpoch(), file_size});
+  // If this file is being overwritten, replace the existing entry rather than counting it twice
+  HashTime* existing = filename_map_.value(file_name);
+  if (existing) {
+    RemoveEntry(existing);
+  }
 
-  consumption_ += file_size;
+  // Accesses are only journaled alongside other writes rather than on every frame request
+  FlushPendingAccesses();
+
+  JournalAdd(AddEntry(file_name, hash, QDateTime::currentMSecsSinceEpoch(), file_size));
 
   QList<QByteArray> deleted_hashes;
 
-  while (consumption_ > DiskLimit()) {
+  while (consumption_ > DiskLimit() && lru_head_ != lru_tail_) {
     deleted_hashes.append(DeleteLeastRecent());
   }
 
+  CompactIfNecessary(false);
+
   lock_.unlock();
 
   foreach (const QByteArray& h, deleted_hashes) {
@@ -173,22 +191,33 @@ bool DiskManager::ClearDiskCache(bool quick_delete)
   if (quick_delete) {
     deleted_files = QDir(FileFunctions::GetMediaCacheLocation()).removeRecursively();
 
-    disk_data_.clear();
+    ClearEntries();
+
+    JournalClear();
+
+    memory_frames_.clear();
+    memory_frame_map_.clear();
+    memory_consumption_ = 0;
   } else {
     deleted_files = true;
 
-    for (int i=0;i<disk_data_.size();i++) {
-      const HashTime& ht = disk_data_.at(i);
+    HashTime* h = lru_head_;
+
+    while (h) {
+      HashTime* next = h->next;
 
       // We return a false result if any of the files fail to delete, but still try to delete as many as we can
-      if (QFile::remove(ht.file_name) || !QFileInfo::exists(ht.file_name)) {
-        emit DeletedFrame(ht.hash);
-        disk_data_.removeAt(i);
-        i--;
+      if (QFile::remove(h->file_name) || !QFileInfo::exists(h->file_name)) {
+        emit DeletedFrame(h->hash);
+        RemoveFrameFromMemory(h->hash);
+        JournalRemove(h->file_name);
+        RemoveEntry(h);
       } else {
-        qWarning() << "Failed to delete" << ht.file_name;
+        qWarning() << "Failed to delete" << h->file_name;
         deleted_files = false;
       }
+
+      h = next;
     }
   }
 
@@ -199,13 +228,71 @@ bool DiskManager::ClearDiskCache(bool quick_delete)
 
 QByteArray DiskManager::DeleteLeastRecent()
 {
-  HashTime h = disk_data_.takeFirst();
+  HashTime* h = lru_head_;
+
+  QByteArray hash = h->hash;
+
+  QFile::remove(h->file_name);
+
+  RemoveFrameFromMemory(hash);
+
+  JournalRemove(h->file_name);
+
+  RemoveEntry(h);
+
+  return hash;
+}
+
+void DiskManager::AddFrameToMemory(const QByteArray &hash, FramePtr frame)
+{
+  QMutexLocker locker(&lock_);
 
-  QFile::remove(h.file_name);
+  RemoveFrameFromMemory(hash);
 
-  consumption_ -= h.file_size;
+  memory_frame_map_.insert(hash, memory_frames_.insert(memory_frames_.end(), {hash, frame}));
+  memory_consumption_ += frame->allocated_size();
 
-  return h.hash;
+  qint64 limit = MemoryLimit();
+
+  while (memory_consumption_ > limit && !memory_frames_.isEmpty()) {
+    RemoveFrameFromMemory(memory_frames_.first().hash);
+  }
+}
+
+FramePtr DiskManager::GetFrameFromMemory(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QByteArray, QLinkedList<MemoryFrame>::iterator>::iterator i = memory_frame_map_.find(hash);
+
+  if (i == memory_frame_map_.end()) {
+    return nullptr;
+  }
+
+  // Move to the back of the list as the most recently used
+  MemoryFrame f = *i.value();
+  memory_frames_.erase(i.value());
+  i.value() = memory_frames_.insert(memory_frames_.end(), f);
+
+  return f.frame;
+}
+
+bool DiskManager::IsFrameInMemory(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  return memory_frame_map_.contains(hash);
+}
+
+void DiskManager::RemoveFrameFromMemory(const QByteArray &hash)
+{
+  QHash<QByteArray, QLinkedList<MemoryFrame>::iterator>::iterator i = memory_frame_map_.find(hash);
+
+  if (i != memory_frame_map_.end()) {
+    memory_consumption_ -= i.value()->frame->allocated_size();
+    memory_frames_.erase(i.value());
+    memory_frame_map_.erase(i);
+  }
 }
 
 qint64 DiskManager::DiskLimit()
@@ -216,6 +303,14 @@ qint64 DiskManager::DiskLimit()
   return qRound64(gigabytes * 1073741824);
 }
 
+qint64 DiskManager::MemoryLimit()
+{
+  double gigabytes = Config::Current()["MemoryCacheSize"].toDouble();
+
+  // Convert gigabytes to bytes
+  return qRound64(gigabytes * 1073741824);
+}
+
 QString DiskManager::GetCacheIndexFilename()
 {
   QDir d(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
@@ -223,4 +318,363 @@ QString DiskManager::GetCacheIndexFilename()
   return d.filePath("diskindex");
 }
 
+QString DiskManager::GetCacheJournalFilename()
+{
+  return GetCacheIndexFilename().append(QStringLiteral(".journal"));
+}
+
+QString DiskManager::GetCompactingJournalFilename()
+{
+  return GetCacheIndexFilename().append(QStringLiteral(".journal.old"));
+}
+
+DiskManager::HashTime *DiskManager::AddEntry(const QString &file_name, const QByteArray &hash, qint64 access_time, qint64 file_size)
+{
+  HashTime* h = new HashTime({file_name, hash, access_time, file_size, nullptr, nullptr});
+
+  filename_map_.insert(file_name, h);
+
+  // Files registered without a hash (e.g. decoder frame caches) are only looked up by filename
+  if (!hash.isEmpty()) {
+    hash_map_.insert(hash, h);
+  }
+
+  LinkToBack(h);
+
+  consumption_ += file_size;
+
+  return h;
+}
+
+void DiskManager::RemoveEntry(DiskManager::HashTime *h)
+{
+  Unlink(h);
+
+  filename_map_.remove(h->file_name);
+
+  // Other files with the same hash keep their mappings
+  if (!h->hash.isEmpty()) {
+    hash_map_.remove(h->hash, h);
+  }
+
+  consumption_ -= h->file_size;
+
+  delete h;
+}
+
+void DiskManager::Touch(DiskManager::HashTime *h)
+{
+  // The viewer re-requests the same frame constantly while paused, in which case this entry is already the most
+  // recent and there's nothing to do
+  if (h == lru_tail_) {
+    return;
+  }
+
+  h->access_time = QDateTime::currentMSecsSinceEpoch();
+
+  Unlink(h);
+  LinkToBack(h);
+
+  pending_accesses_.insert(h->file_name);
+}
+
+void DiskManager::LinkToBack(DiskManager::HashTime *h)
+{
+  h->prev = lru_tail_;
+  h->next = nullptr;
+
+  if (lru_tail_) {
+    lru_tail_->next = h;
+  } else {
+    lru_head_ = h;
+  }
+
+  lru_tail_ = h;
+}
+
+void DiskManager::Unlink(DiskManager::HashTime *h)
+{
+  if (h->prev) {
+    h->prev->next = h->next;
+  } else {
+    lru_head_ = h->next;
+  }
+
+  if (h->next) {
+    h->next->prev = h->prev;
+  } else {
+    lru_tail_ = h->prev;
+  }
+
+  h->prev = nullptr;
+  h->next = nullptr;
+}
+
+void DiskManager::ClearEntries()
+{
+  HashTime* h = lru_head_;
+
+  while (h) {
+    HashTime* next = h->next;
+    delete h;
+    h = next;
+  }
+
+  lru_head_ = nullptr;
+  lru_tail_ = nullptr;
+
+  filename_map_.clear();
+  hash_map_.clear();
+
+  pending_accesses_.clear();
+
+  consumption_ = 0;
+}
+
+void DiskManager::LoadJournal(const QString &filename)
+{
+  QFile journal_file(filename);
+
+  if (!journal_file.open(QFile::ReadOnly)) {
+    return;
+  }
+
+  QDataStream ds(&journal_file);
+
+  while (!journal_file.atEnd()) {
+    quint8 op;
+    QString file_name;
+
+    ds >> op;
+
+    if (ds.status() != QDataStream::Ok) {
+      break;
+    }
+
+    if (op == kJournalClear) {
+      ClearEntries();
+      continue;
+    }
+
+    ds >> file_name;
+
+    if (op == kJournalAdd) {
+      QByteArray hash;
+      qint64 access_time;
+      qint64 file_size;
+
+      ds >> hash;
+      ds >> access_time;
+      ds >> file_size;
+
+      // A crash may have left a partially written record at the end of the journal
+      if (ds.status() != QDataStream::Ok) {
+        break;
+      }
+
+      // Adds may be replayed twice if a compaction was interrupted, so replace rather than duplicate
+      HashTime* existing = filename_map_.value(file_name);
+      if (existing) {
+        RemoveEntry(existing);
+      }
+
+      AddEntry(file_name, hash, access_time, file_size);
+    } else {
+      if (ds.status() != QDataStream::Ok) {
+        break;
+      }
+
+      HashTime* h = filename_map_.value(file_name);
+
+      if (h) {
+        if (op == kJournalRemove) {
+          RemoveEntry(h);
+        } else if (op == kJournalAccess) {
+          Touch(h);
+        }
+      }
+    }
+
+    journal_record_count_++;
+  }
+}
+
+void DiskManager::OpenJournal()
+{
+  journal_.setFileName(GetCacheJournalFilename());
+
+  if (!journal_.open(QFile::WriteOnly | QFile::Append)) {
+    qWarning() << "Failed to open cache journal:" << journal_.fileName();
+  }
+}
+
+void DiskManager::JournalAdd(const DiskManager::HashTime *h)
+{
+  if (!journal_.isOpen()) {
+    return;
+  }
+
+  QDataStream ds(&journal_);
+
+  ds << quint8(kJournalAdd);
+  ds << h->file_name;
+  ds << h->hash;
+  ds << h->access_time;
+  ds << h->file_size;
+
+  journal_.flush();
+
+  journal_record_count_++;
+}
+
+void DiskManager::JournalRemove(const QString &file_name)
+{
+  if (!journal_.isOpen()) {
+    return;
+  }
+
+  QDataStream ds(&journal_);
+
+  ds << quint8(kJournalRemove);
+  ds << file_name;
+
+  journal_.flush();
+
+  journal_record_count_++;
+}
+
+void DiskManager::JournalClear()
+{
+  if (!journal_.isOpen()) {
+    return;
+  }
+
+  QDataStream ds(&journal_);
+
+  ds << quint8(kJournalClear);
+
+  journal_.flush();
+
+  journal_record_count_++;
+}
+
+void DiskManager::FlushPendingAccesses()
+{
+  if (pending_accesses_.isEmpty() || !journal_.isOpen()) {
+    return;
+  }
+
+  QDataStream ds(&journal_);
+
+  // Record in LRU order so replaying these produces the same order we have now
+  for (HashTime* h=lru_head_;h && !pending_accesses_.isEmpty();h=h->next) {
+    if (pending_accesses_.remove(h->file_name)) {
+      ds << quint8(kJournalAccess);
+      ds << h->file_name;
+
+      journal_record_count_++;
+    }
+  }
+
+  journal_.flush();
+
+  pending_accesses_.clear();
+}
+
+void DiskManager::CompactIfNecessary(bool wait)
+{
+  // Wait for any previous compaction to finish before starting another
+  if (compact_future_.isRunning()) {
+    if (wait) {
+      compact_future_.waitForFinished();
+    } else {
+      return;
+    }
+  }
+
+  // Rewrite the index once the journal grows larger than the index itself (with a reasonable minimum so small caches
+  // aren't rewritten constantly)
+  const int kMinimumJournalRecords = 4096;
+
+  if (!wait
+      && (journal_record_count_ < kMinimumJournalRecords || journal_record_count_ < filename_map_.size())) {
+    return;
+  }
+
+  QVector<HashTime> entries;
+  entries.reserve(filename_map_.size());
+
+  for (HashTime* h=lru_head_;h;h=h->next) {
+    entries.append(*h);
+  }
+
+  // Move the current journal aside and start a new one. The old journal is only deleted once the new index has been
+  // safely written, so a crash during compaction loses nothing.
+  journal_.close();
+
+  if (QFile::exists(GetCompactingJournalFilename())) {
+    // A previous compaction failed to write the index, so the records in its journal still only exist there. Fold the
+    // current journal into it rather than replacing it. If we crash before the current journal is removed, both are
+    // replayed, which is harmless since replaying a record twice has the same result as replaying it once.
+    QFile current_journal(GetCacheJournalFilename());
+
+    if (current_journal.exists()) {
+      QFile compacting_journal(GetCompactingJournalFilename());
+
+      bool folded = false;
+
+      if (compacting_journal.open(QFile::WriteOnly | QFile::Append)
+          && current_journal.open(QFile::ReadOnly)) {
+        QByteArray records = current_journal.readAll();
+
+        folded = (compacting_journal.write(records) == records.size() && compacting_journal.flush());
+
+        current_journal.close();
+      }
+
+      compacting_journal.close();
+
+      if (!folded || !current_journal.remove()) {
+        qWarning() << "Failed to fold cache journal into" << compacting_journal.fileName();
+        OpenJournal();
+        return;
+      }
+    }
+  } else {
+    QFile::rename(GetCacheJournalFilename(), GetCompactingJournalFilename());
+  }
+
+  journal_record_count_ = 0;
+
+  if (wait) {
+    WriteIndex(entries, GetCompactingJournalFilename());
+  } else {
+    OpenJournal();
+    compact_future_ = QtConcurrent::run(&DiskManager::WriteIndex, entries, GetCompactingJournalFilename());
+  }
+}
+
+void DiskManager::WriteIndex(QVector<HashTime> entries, QString compacted_journal)
+{
+  QSaveFile cache_index_file(GetCacheIndexFilename());
+
+  if (cache_index_file.open(QFile::WriteOnly)) {
+    QDataStream ds(&cache_index_file);
+
+    foreach (const HashTime& h, entries) {
+      ds << h.file_name;
+      ds << h.hash;
+      ds << h.access_time;
+      ds << h.file_size;
+    }
+
+    if (cache_index_file.commit()) {
+      QFile::remove(compacted_journal);
+      return;
+    }
+  }
+
+  qWarning() << "Failed to write cache index:" << GetCacheIndexFilename();
+}
+
 OLIVE_NAMESPACE_EXIT
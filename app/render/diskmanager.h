@@ -21,9 +21,15 @@
 #ifndef DISKMANAGER_H
 #define DISKMANAGER_H
 
+#include <QFile>
+#include <QHash>
+#include <QLinkedList>
 #include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QtConcurrent/QtConcurrent>
 
+#include "codec/frame.h"
 #include "common/define.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -42,10 +48,32 @@ public:
 
   void Accessed(const QString& filename);
 
-  void CreatedFile(const QString& file_name, const QByteArray& hash);
-
   bool ClearDiskCache(bool quick_delete);
 
+  /**
+   * @brief Keep a rendered frame in memory so it can be shown without reading it back from disk
+   *
+   * Frames in memory are evicted least-recently-used once they exceed the "MemoryCacheSize" limit. A frame that's
+   * evicted from the disk cache is also evicted from memory.
+   */
+  void AddFrameToMemory(const QByteArray& hash, FramePtr frame);
+
+  /**
+   * @brief Returns a frame previously added with AddFrameToMemory() or nullptr if it's no longer in memory
+   */
+  FramePtr GetFrameFromMemory(const QByteArray& hash);
+
+  bool IsFrameInMemory(const QByteArray& hash);
+
+public slots:
+  /**
+   * @brief Register a newly written file with the cache
+   *
+   * Safe to call from any thread, calls from other threads are queued to run on this object's thread since this reads
+   * the disk limit from Config.
+   */
+  void CreatedFile(const QString& file_name, const QByteArray& hash);
+
 signals:
   void DeletedFrame(const QByteArray& hash);
 
@@ -60,19 +88,105 @@ private:
 
   qint64 DiskLimit();
 
+  qint64 MemoryLimit();
+
+  struct MemoryFrame {
+    QByteArray hash;
+    FramePtr frame;
+  };
+
+  void RemoveFrameFromMemory(const QByteArray& hash);
+
   static QString GetCacheIndexFilename();
 
+  static QString GetCacheJournalFilename();
+
+  static QString GetCompactingJournalFilename();
+
+  /**
+   * @brief An entry in the disk cache index
+   *
+   * Entries are linked together in least-recently-used order (the head is the least recently accessed and the tail is
+   * the most recently accessed) so that touching and evicting an entry are both constant time.
+   */
   struct HashTime {
     QString file_name;
     QByteArray hash;
     qint64 access_time;
     qint64 file_size;
+
+    HashTime* prev;
+    HashTime* next;
+  };
+
+  HashTime* AddEntry(const QString& file_name, const QByteArray& hash, qint64 access_time, qint64 file_size);
+
+  void RemoveEntry(HashTime* h);
+
+  void Touch(HashTime* h);
+
+  void LinkToBack(HashTime* h);
+
+  void Unlink(HashTime* h);
+
+  void ClearEntries();
+
+  /**
+   * @brief Operations recorded in the cache journal
+   *
+   * The journal is an append-only log of changes made since the index was last written in full. It's replayed on top
+   * of the index on startup so that the cache survives a crash.
+   */
+  enum JournalOp {
+    kJournalAdd,
+    kJournalRemove,
+    kJournalAccess,
+    kJournalClear
   };
 
-  QList<HashTime> disk_data_;
+  void LoadJournal(const QString& filename);
+
+  void OpenJournal();
+
+  void JournalAdd(const HashTime* h);
+
+  void JournalRemove(const QString& file_name);
+
+  void JournalClear();
+
+  void FlushPendingAccesses();
+
+  void CompactIfNecessary(bool wait);
+
+  static void WriteIndex(QVector<HashTime> entries, QString compacted_journal);
+
+  QHash<QString, HashTime*> filename_map_;
+
+  /**
+   * @brief Entries by hash, a hash can have more than one file (e.g. the same frame cached in different formats)
+   */
+  QMultiHash<QByteArray, HashTime*> hash_map_;
+
+  HashTime* lru_head_;
+
+  HashTime* lru_tail_;
+
+  QFile journal_;
+
+  int journal_record_count_;
+
+  QSet<QString> pending_accesses_;
+
+  QFuture<void> compact_future_;
 
   qint64 consumption_;
 
+  QLinkedList<MemoryFrame> memory_frames_;
+
+  QHash<QByteArray, QLinkedList<MemoryFrame>::iterator> memory_frame_map_;
+
+  qint64 memory_consumption_;
+
   QMutex lock_;
 
 };
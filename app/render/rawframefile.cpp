@@ -0,0 +1,121 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rawframefile.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+OLIVE_NAMESPACE_ENTER
+
+const QString RawFrameFile::kExtension = QStringLiteral("orf");
+const char RawFrameFile::kMagic[4] = {'O', 'R', 'F', '1'};
+const qint32 RawFrameFile::kVersion = 1;
+const qint32 RawFrameFile::kMaxDimension = 32768;
+
+bool RawFrameFile::Write(const QString &filename, FramePtr frame)
+{
+  // Readers may open the file at any time, so it's written to a temporary file that only replaces it once complete
+  QSaveFile f(filename);
+
+  if (!f.open(QFile::WriteOnly)) {
+    qCritical() << "Failed to open raw frame file for writing:" << filename;
+    return false;
+  }
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.width = frame->width();
+  header.height = frame->height();
+  header.format = frame->format();
+  header.linesize_bytes = frame->linesize_bytes();
+
+  qint64 data_size = frame->allocated_size();
+
+  if (f.write(reinterpret_cast<const char*>(&header), sizeof(Header)) != sizeof(Header)
+      || f.write(frame->const_data(), data_size) != data_size) {
+    qCritical() << "Failed to write raw frame file:" << filename;
+    f.cancelWriting();
+    return false;
+  }
+
+  if (!f.commit()) {
+    qCritical() << "Failed to write raw frame file:" << filename;
+    return false;
+  }
+
+  return true;
+}
+
+bool RawFrameFile::Read(const QString &filename, Frame *frame)
+{
+  QFile f(filename);
+
+  if (!f.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  Header header;
+
+  if (f.read(reinterpret_cast<char*>(&header), sizeof(Header)) != sizeof(Header)
+      || memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+      || header.version != kVersion
+      || header.format <= PixelFormat::PIX_FMT_INVALID
+      || header.format >= PixelFormat::PIX_FMT_COUNT) {
+    qWarning() << "Invalid raw frame file:" << filename;
+    return false;
+  }
+
+  PixelFormat::Format format = static_cast<PixelFormat::Format>(header.format);
+
+  // Check the dimensions are plausible and the file is exactly as long as they say before allocating anything, so a
+  // corrupt or truncated file can't make us allocate a nonsensical amount of memory
+  if (header.width <= 0
+      || header.height <= 0
+      || header.width > kMaxDimension
+      || header.height > kMaxDimension
+      || header.linesize_bytes < static_cast<qint64>(header.width) * PixelFormat::BytesPerPixel(format)
+      || f.size() != static_cast<qint64>(sizeof(Header)) + static_cast<qint64>(header.linesize_bytes) * header.height) {
+    qWarning() << "Invalid raw frame file:" << filename;
+    return false;
+  }
+
+  if (!frame->is_allocated()
+      || frame->width() != header.width
+      || frame->height() != header.height
+      || frame->format() != format) {
+    frame->set_video_params(VideoRenderingParams(header.width, header.height, format));
+    frame->allocate();
+  }
+
+  // Frame's linesize alignment is fixed so this should always match, but check in case that ever changes
+  if (frame->linesize_bytes() != header.linesize_bytes) {
+    qWarning() << "Raw frame file has mismatched linesize:" << filename;
+    return false;
+  }
+
+  qint64 data_size = frame->allocated_size();
+
+  return (f.read(frame->data(), data_size) == data_size);
+}
+
+OLIVE_NAMESPACE_EXIT
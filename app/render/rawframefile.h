@@ -0,0 +1,80 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RAWFRAMEFILE_H
+#define RAWFRAMEFILE_H
+
+#include <QString>
+
+#include "codec/frame.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Reads and writes frames in a simple uncompressed single-file container
+ *
+ * Used by the disk cache as a lossless alternative to JPEG/EXR. The file is a small header followed by the frame's
+ * buffer exactly as it's laid out in memory, so writing and reading are each a single copy and cached frames are
+ * bit-identical to what was rendered. The trade-off is that these files are considerably larger.
+ *
+ * These files are only meant to be read back on the machine that wrote them, so no attempt is made to handle
+ * endianness.
+ */
+class RawFrameFile
+{
+public:
+  /**
+   * @brief File extension used for raw frame files
+   */
+  static const QString kExtension;
+
+  static bool Write(const QString& filename, FramePtr frame);
+
+  /**
+   * @brief Read a raw frame file into `frame`
+   *
+   * `frame` is only reallocated if its current parameters don't match the file's.
+   */
+  static bool Read(const QString& filename, Frame* frame);
+
+private:
+  struct Header {
+    char magic[4];
+    qint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    qint32 linesize_bytes;
+  };
+
+  static const char kMagic[4];
+
+  static const qint32 kVersion;
+
+  /**
+   * @brief Largest width or height a file is trusted to have
+   */
+  static const qint32 kMaxDimension;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // RAWFRAMEFILE_H
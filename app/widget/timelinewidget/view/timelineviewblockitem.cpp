@@ -22,17 +22,15 @@
 
 #include <QBrush>
 #include <QCoreApplication>
-#include <QDir>
-#include <QFloat16>
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
 
 #include "common/qtutils.h"
-#include "config/config.h"
 #include "core.h"
 #include "node/block/transition/transition.h"
+#include "node/input/media/media.h"
 #include "widget/viewer/audiowaveformview.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -56,6 +54,23 @@ Block *TimelineViewBlockItem::block() const
   return block_;
 }
 
+AudioStreamPtr TimelineViewBlockItem::GetAudioStream() const
+{
+  foreach (Node* dep, block_->GetDependencies()) {
+    MediaInput* media = dynamic_cast<MediaInput*>(dep);
+
+    if (media) {
+      StreamPtr stream = media->footage();
+
+      if (stream && stream->type() == Stream::kAudio) {
+        return std::static_pointer_cast<AudioStream>(stream);
+      }
+    }
+  }
+
+  return nullptr;
+}
+
 void TimelineViewBlockItem::UpdateRect()
 {
   double item_left = TimeToScene(block_->in());
@@ -96,31 +111,22 @@ void TimelineViewBlockItem::paint(QPainter *painter, const QStyleOptionGraphicsI
     }
 
     // Draw waveform if one is available
-    QString wave_fn = QDir(QDir(Config::Current()["DiskCachePath"].toString()).filePath("waveform")).filePath(QString::number(reinterpret_cast<quintptr>(block_)));
-    QFile wave_file(wave_fn);
-    if (wave_file.open(QFile::ReadOnly)){
-      painter->setPen(QColor(64, 64, 64));
-
-      QByteArray w = wave_file.readAll();
+    {
+      AudioStreamPtr stream = GetAudioStream();
+      QString waveform_fn = stream ? stream->waveform_filename() : QString();
+      WaveformPyramid waveform;
 
-      wave_file.close();
+      if (!waveform_fn.isEmpty() && waveform.open(waveform_fn)) {
+        painter->setPen(QColor(64, 64, 64));
 
-      // Read metadata
-      SampleSummer::Info info;
-      QFile wave_meta(wave_fn.append(QStringLiteral(".meta")));
-      if (wave_meta.open(QFile::ReadOnly)) {
-        wave_meta.read(reinterpret_cast<char*>(&info), sizeof(SampleSummer::Info));
-        wave_meta.close();
-      }
-
-      // Prevent divide by zero
-      if (info.channels) {
         AudioWaveformView::DrawWaveform(painter,
                                         rect().toRect(),
-                                        this->GetScale(),
-                                        reinterpret_cast<const SampleSummer::Sum*>(w.constData()),
-                                        w.size() / sizeof(SampleSummer::Sum),
-                                        info.channels);
+                                        waveform,
+                                        block_->media_in().toDouble(),
+                                        (block_->length() * qAbs(block_->speed())).toDouble(),
+                                        block_->is_reversed());
+
+        waveform.close();
       }
     }
 
@@ -23,6 +23,7 @@
 
 #include "timelineviewrect.h"
 #include "node/block/clip/clip.h"
+#include "project/item/footage/audiostream.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -42,6 +43,11 @@ protected:
   virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
 
 private:
+  /**
+   * @brief Finds the audio footage this block plays, if any, so its waveform can be drawn
+   */
+  AudioStreamPtr GetAudioStream() const;
+
   Block* block_;
 
 };
@@ -58,37 +58,33 @@ void AudioWaveformView::SetBackend(AudioRenderBackend *backend)
   ForceUpdate();
 }
 
-void AudioWaveformView::DrawWaveform(QPainter *painter, const QRect& rect, const double& scale, const SampleSummer::Sum* samples, int nb_samples, int channels)
+void AudioWaveformView::DrawWaveform(QPainter *painter, const QRect& rect, const WaveformPyramid& waveform, double start, double length, bool reversed)
 {
-  int sample_index, next_sample_index = 0;
-
-  QVector<SampleSummer::Sum> summary;
-  int summary_index = -1;
+  if (!waveform.is_open() || !waveform.channel_count() || rect.width() <= 0 || length <= 0) {
+    return;
+  }
 
+  int channels = waveform.channel_count();
   int channel_height = rect.height() / channels;
   int channel_half_height = channel_height / 2;
 
-  for (int i=0;i<rect.width();i++) {
-    sample_index = next_sample_index;
+  double seconds_per_pixel = length / static_cast<double>(rect.width());
+  int level = waveform.GetLevelForRate(1.0 / seconds_per_pixel);
 
-    if (sample_index == nb_samples) {
-      break;
-    }
+  bool rectified = Config::Current()[QStringLiteral("RectifiedWaveforms")].toBool();
 
-    next_sample_index = qMin(nb_samples,
-                             qFloor(static_cast<double>(SampleSummer::kSumSampleRate) * static_cast<double>(i+1) / scale) * channels);
+  for (int i=0;i<rect.width();i++) {
+    // If reversed, the start of the media is drawn on the right
+    int pixel = reversed ? rect.width() - i - 1 : i;
 
-    if (summary_index != sample_index) {
-      summary = SampleSummer::ReSumSamples(&samples[sample_index],
-                                           qMax(channels, next_sample_index - sample_index),
-                                           channels);
-      summary_index = sample_index;
-    }
+    QVector<SampleSummer::Sum> summary = waveform.Summarize(level,
+                                                            start + seconds_per_pixel * pixel,
+                                                            start + seconds_per_pixel * (pixel + 1));
 
     int line_x = i + rect.x();
 
     for (int j=0;j<summary.size();j++) {
-      if (Config::Current()[QStringLiteral("RectifiedWaveforms")].toBool()) {
+      if (rectified) {
         int channel_bottom = rect.y() + channel_height * (j + 1);
 
         int diff = qRound((summary.at(j).max - summary.at(j).min) * channel_half_height);
@@ -140,24 +136,38 @@ void AudioWaveformView::paintEvent(QPaintEvent *event)
 
       int drew = 0;
 
-      fs.seek(params.samples_to_bytes(ScreenToUnitRounded(0)));
+      qint64 start_pos = qMax(static_cast<qint64>(0), static_cast<qint64>(params.samples_to_bytes(ScreenToUnitRounded(0))));
+      qint64 end_pos = params.samples_to_bytes(ScreenToUnitRounded(width()));
 
-      for (int x=0; x<width() && !fs.atEnd(); x++) {
+      // The cache is still being rendered and can be truncated at any time, so rather than mapping it we read the
+      // visible range in one call and sum each pixel's samples from that
+      QByteArray visible;
 
-        int samples_len = ScreenToUnitRounded(x+1) - ScreenToUnitRounded(x);
-        int max_read_size = params.samples_to_bytes(samples_len);
+      if (end_pos > start_pos && fs.seek(start_pos)) {
+        visible = fs.read(end_pos - start_pos);
+      }
+
+      const char* visible_data = visible.constData();
+      qint64 visible_size = visible.size();
+      qint64 read_pos = 0;
 
-        QByteArray read_buffer = fs.read(max_read_size);
+      for (int x=0; x<width() && read_pos < visible_size; x++) {
+
+        int samples_len = ScreenToUnitRounded(x+1) - ScreenToUnitRounded(x);
+        qint64 read_size = params.samples_to_bytes(samples_len);
 
         // Detect whether we've reached EOF and recalculate sample count if so
-        if (read_buffer.size() < max_read_size) {
-          samples_len = params.bytes_to_samples(read_buffer.size());
+        if (read_pos + read_size > visible_size) {
+          read_size = visible_size - read_pos;
+          samples_len = params.bytes_to_samples(static_cast<int>(read_size));
         }
 
-        QVector<SampleSummer::Sum> samples = SampleSummer::SumSamples(reinterpret_cast<const float*>(read_buffer.constData()),
+        QVector<SampleSummer::Sum> samples = SampleSummer::SumSamples(reinterpret_cast<const float*>(visible_data + read_pos),
                                                                       samples_len,
                                                                       params.channel_count());
 
+        read_pos += read_size;
+
         for (int i=0;i<params.channel_count();i++) {
           if (Config::Current()[QStringLiteral("RectifiedWaveforms")].toBool()) {
             int channel_bottom = channel_height * (i + 1);
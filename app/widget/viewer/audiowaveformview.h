@@ -24,6 +24,7 @@
 #include <QWidget>
 
 #include "audio/sumsamples.h"
+#include "audio/waveformpyramid.h"
 #include "render/audioparams.h"
 #include "render/backend/audiorenderbackend.h"
 #include "widget/timeruler/seekablewidget.h"
@@ -40,7 +41,12 @@ public:
 
   void SetBackend(AudioRenderBackend* backend);
 
-  static void DrawWaveform(QPainter* painter, const QRect &rect, const double &scale, const SampleSummer::Sum *samples, int nb_samples, int channels);
+  /**
+   * @brief Draws `length` seconds of a waveform starting at `start` to fill `rect`
+   *
+   * Uses whichever level of the pyramid has closest to one sum per pixel.
+   */
+  static void DrawWaveform(QPainter* painter, const QRect &rect, const WaveformPyramid& waveform, double start, double length, bool reversed);
 
 protected:
   virtual void paintEvent(QPaintEvent* event) override;
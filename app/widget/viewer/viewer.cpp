@@ -341,9 +341,12 @@ void ViewerWidget::UpdateTextureFromNode(const rational& time)
     main_gl_widget()->SetImage(QString());
     video_renderer_->UpdateLastRequestedTime(time);
   } else {
-    QString frame_fn = video_renderer_->GetCachedFrame(time);
+    FramePtr memory_frame;
+    QString frame_fn = video_renderer_->GetCachedFrame(time, &memory_frame);
 
-    if (!frame_fn.isEmpty()) {
+    if (memory_frame) {
+      main_gl_widget()->SetImage(memory_frame);
+    } else if (!frame_fn.isEmpty()) {
       main_gl_widget()->SetImage(frame_fn);
     }
   }
@@ -361,6 +364,8 @@ void ViewerWidget::PlayInternal(int speed, bool in_to_out_only)
   playback_speed_ = speed;
   play_in_to_out_only_ = in_to_out_only;
 
+  video_renderer_->SetPlaybackSpeed(playback_speed_);
+
   QString audio_fn = audio_renderer_->CachePathName();
   if (!audio_fn.isEmpty()) {
     AudioManager::instance()->SetOutputParams(audio_renderer_->params());
@@ -680,6 +685,7 @@ void ViewerWidget::Pause()
   if (IsPlaying()) {
     AudioManager::instance()->StopOutput();
     playback_speed_ = 0;
+    video_renderer_->SetPlaybackSpeed(playback_speed_);
     controls_->ShowPlayButton();
 
     if (stack_->currentWidget() == sizer_) {
@@ -33,6 +33,7 @@
 #include "render/backend/opengl/openglrenderfunctions.h"
 #include "render/backend/opengl/openglshader.h"
 #include "render/pixelformat.h"
+#include "render/rawframefile.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -64,7 +65,30 @@ void ViewerGLWidget::SetImage(const QString &fn)
 {
   has_image_ = false;
 
-  if (!fn.isEmpty() && QFileInfo::exists(fn)) {
+  if (fn.endsWith(RawFrameFile::kExtension)) {
+
+    // Raw frames can be read directly into our load buffer
+    if (RawFrameFile::Read(fn, &load_buffer_)) {
+      makeCurrent();
+
+      if (!texture_.IsCreated()
+          || texture_.width() != load_buffer_.width()
+          || texture_.height() != load_buffer_.height()
+          || texture_.format() != load_buffer_.format()) {
+        texture_.Destroy();
+        texture_.Create(context(), load_buffer_.width(), load_buffer_.height(), load_buffer_.format());
+      }
+
+      texture_.Upload(load_buffer_.const_data(), load_buffer_.linesize_pixels());
+
+      emit LoadedTexture(&texture_);
+
+      doneCurrent();
+
+      has_image_ = true;
+    }
+
+  } else if (!fn.isEmpty() && QFileInfo::exists(fn)) {
     auto input = OIIO::ImageInput::open(fn.toStdString());
 
     if (input) {
@@ -119,6 +143,43 @@ void ViewerGLWidget::SetImage(const QString &fn)
   }
 }
 
+void ViewerGLWidget::SetImage(FramePtr frame)
+{
+  has_image_ = false;
+
+  if (frame && frame->is_allocated()) {
+    // Ensure the following texture operations are done in our context (in case we're in a separate window for instance)
+    makeCurrent();
+
+    if (!texture_.IsCreated()
+        || texture_.width() != frame->width()
+        || texture_.height() != frame->height()
+        || texture_.format() != frame->format()) {
+      texture_.Destroy();
+      texture_.Create(context(), frame->width(), frame->height(), frame->format());
+    }
+
+    // Frame's data is implicitly shared so this doesn't copy the image
+    load_buffer_ = *frame;
+
+    texture_.Upload(load_buffer_.const_data(), load_buffer_.linesize_pixels());
+
+    emit LoadedTexture(&texture_);
+
+    doneCurrent();
+
+    has_image_ = true;
+  }
+
+  update();
+
+  if (has_image_) {
+    emit LoadedBuffer(&load_buffer_);
+  } else {
+    emit LoadedBuffer(nullptr);
+  }
+}
+
 void ViewerGLWidget::SetSignalCursorColorEnabled(bool e)
 {
   signal_cursor_color_ = e;
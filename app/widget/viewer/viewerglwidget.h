@@ -69,6 +69,13 @@ public:
    */
   void SetImage(const QString& fn);
 
+  /**
+   * @brief Set an image that's already in memory to display on screen
+   *
+   * The frame's data is shared rather than copied.
+   */
+  void SetImage(FramePtr frame);
+
   const QMatrix4x4& GetMatrix();
 
   void ConnectSibling(ViewerGLWidget* sibling);
@@ -37,6 +37,10 @@ MainStatusBar::MainStatusBar(QWidget *parent) :
   bar_->setMaximum(100);
   bar_->setVisible(false);
 
+  disk_cache_label_ = new QLabel();
+  addPermanentWidget(disk_cache_label_);
+  disk_cache_label_->setVisible(false);
+
   showMessage(tr("Welcome to %1 %2").arg(QCoreApplication::applicationName(), QCoreApplication::applicationVersion()));
 }
 
@@ -53,6 +57,20 @@ void MainStatusBar::ConnectTaskManager(TaskManager *manager)
   }
 }
 
+void MainStatusBar::ConnectDiskCacheWriter(DiskCacheWriter *writer)
+{
+  // The writer emits from render and writer threads, so this is queued onto ours
+  connect(writer, &DiskCacheWriter::QueueDepthChanged, this, &MainStatusBar::UpdateDiskCacheQueueDepth);
+
+  UpdateDiskCacheQueueDepth(writer->GetQueueDepth());
+}
+
+void MainStatusBar::UpdateDiskCacheQueueDepth(int depth)
+{
+  disk_cache_label_->setText(tr("Writing %n cached frame(s)", nullptr, depth));
+  disk_cache_label_->setVisible(depth > 0);
+}
+
 void MainStatusBar::UpdateStatus()
 {
   if (!manager_) {
@@ -21,9 +21,11 @@
 #ifndef MAINSTATUSBAR_H
 #define MAINSTATUSBAR_H
 
+#include <QLabel>
 #include <QProgressBar>
 #include <QStatusBar>
 
+#include "render/diskcachewriter.h"
 #include "task/taskmanager.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -38,14 +40,23 @@ public:
 
   void ConnectTaskManager(TaskManager* manager);
 
+  /**
+   * @brief Show how many rendered frames are waiting to be written to the disk cache
+   */
+  void ConnectDiskCacheWriter(DiskCacheWriter* writer);
+
 private slots:
   void UpdateStatus();
 
+  void UpdateDiskCacheQueueDepth(int depth);
+
 private:
   TaskManager* manager_;
 
   QProgressBar* bar_;
 
+  QLabel* disk_cache_label_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -62,6 +62,7 @@ MainWindow::MainWindow(QWidget *parent) :
   // Create and set status bar
   MainStatusBar* status_bar = new MainStatusBar(this);
   status_bar->ConnectTaskManager(TaskManager::instance());
+  status_bar->ConnectDiskCacheWriter(DiskCacheWriter::instance());
   setStatusBar(status_bar);
 
   // Create standard panels